@@ -20,11 +20,24 @@
 
 #include <stddef.h>
 #include <stdint.h>
-#include "core-util/CriticalSectionLock.h"
+#include <string.h>
+#include <new>
+#include "core-util/GrowthPolicy.h"
+#include "core-util/LockPolicy.h"
 #include "core-util/PoolAllocator.h"
+#include "core-util/atomic_ops.h"
 #include "core-util/core-util.h"
 #include "ualloc/ualloc.h"
 
+// Can elements of type T be copied with memcpy?
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5))
+#define MBED_UTIL_ARRAY_IS_TRIVIALLY_COPYABLE(T) __is_trivially_copyable(T)
+#elif defined(__GNUC__)
+#define MBED_UTIL_ARRAY_IS_TRIVIALLY_COPYABLE(T) __has_trivial_copy(T)
+#else
+#define MBED_UTIL_ARRAY_IS_TRIVIALLY_COPYABLE(T) false
+#endif
+
 namespace mbed {
 namespace util {
 
@@ -38,13 +51,31 @@ namespace util {
   * in a runtime error or cause undefined behaviour.
   *
   * If the templated type is a class or a struct, it needs to have a copy constructor
+  *
+  * The memory areas (zones) of the array are kept in a directory, so an element is found without
+  * walking the list of zones. When all the zones after the first one have the same size (fixed
+  * growth policy) or each zone doubles the capacity of the array (doubling growth policy), the
+  * zone is computed directly from the index, in O(1). Otherwise it is found with a binary search
+  * over the directory.
+  *
+  * 'push_back' can be called concurrently (from different threads or from interrupt handlers)
+  * without taking a lock: the new element's slot is reserved with a compare-and-swap and the element
+  * becomes visible (it is counted by 'get_num_elements') only after it was constructed, together with
+  * all the elements reserved before it. Only allocating a new zone takes the lock of the array,
+  * which is given by the 'Lock' template parameter (see LockPolicy.h).
+  * 'pop_back' must not be called concurrently with 'push_back'.
+  *
+  * An Array with the NullLock policy is only used from one context at a time, so it reserves
+  * and publishes the slots with plain loads and stores instead of atomic operations.
   */
-template <typename T>
+template <typename T, typename Lock=CriticalSectionLock>
 class Array {
+    typedef typename LockTraits<Lock>::guard lock_guard;
+
 public:
     /** Create a new array
       */
-    Array(): _head(NULL) {
+    Array(): _directory(NULL), _capacity(0), _elements(0), _reserved(0), _completed(0) {
     }
 
     ~Array() {
@@ -54,13 +85,16 @@ public:
             p->~T();
         }
         // Now it's safe to destroy our internal data structures
-        array_link *crt = _head, *prev;
-        while (crt != NULL) {
-            prev = crt->prev;
-            void *addr = crt->data;
-            crt->~array_link(); // not really needed, just for completion
-            mbed_ufree(addr);
-            crt = prev;
+        zone_directory *dir = _directory, *retired;
+        if (dir != NULL) {
+            for (unsigned i = 0; i < dir->num_zones; i ++) {
+                mbed_ufree(dir->zones[i].data);
+            }
+        }
+        while (dir != NULL) {
+            retired = dir->retired;
+            mbed_ufree(dir);
+            dir = retired;
         }
     }
 
@@ -72,16 +106,43 @@ public:
       * @returns true if the initialization succeeded, false otherwise
       */
     bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN) {
-        if (_head != NULL)
+        if (_directory != NULL)
             return false; // prevent repeated initialization
         _element_size = PoolAllocator::align_up(sizeof(T), alignment);
-        _grow_capacity = grow_capacity;
+        _growth = GrowthPolicy::fixed(grow_capacity);
         _alloc_traits = alloc_traits;
         _alignment = alignment;
+        _capacity = 0;
+        _elements = _reserved = _completed = 0;
+        _first_zone_size = initial_capacity;
+        _zone_size = 0;
+        _uniform = true;
+        _doubling = initial_capacity > 0;
+        if (!add_zone(initial_capacity))
+            return false;
         _capacity = initial_capacity;
-        _elements = 0;
-        _head = create_new_array(initial_capacity);
-        return _head != NULL;
+        return true;
+    }
+
+    /** Change the policy used to grow the array (by default the array grows by the
+      * 'grow_capacity' given to 'init')
+      * @param growth the new growth policy
+      */
+    void set_growth_policy(const GrowthPolicy& growth) {
+        lock_guard lock(_lock);
+        _growth = growth;
+    }
+
+    /** Make sure that the array has space for at least 'n' elements, so that it doesn't
+      * need to grow until it holds more than 'n' elements
+      * @param n number of elements
+      * @returns true if the array has space for 'n' elements, false otherwise (out of memory)
+      */
+    bool reserve(size_t n) {
+        if (_directory == NULL) {
+            return false;
+        }
+        return grow(n);
     }
 
     /** Subscript operator: return a reference to an existing element
@@ -128,40 +189,95 @@ public:
       * @returns true if the element was added, false otherwise (out of memory)
       */
     bool push_back(const T& new_element) {
-        unsigned idx = _elements, prev_capacity = _capacity;
-        if (_elements == _capacity) {
-            if (_grow_capacity == 0) { // can we grow?
-                return false;
+        uint32_t idx;
+        if (!reserve_slots(1, &idx)) {
+            return false;
+        }
+        new(get_slot_address(idx)) T(new_element);
+        publish(1);
+        return true;
+    }
+
+#ifdef CORE_UTIL_HAS_RVALUE_REFERENCES
+    /** Adds an element at the end of the array, moving it instead of copying it
+      * If there's not enough memory for a new element, a new zone will be allocated
+      * @param new_element element to add
+      * @returns true if the element was added, false otherwise (out of memory)
+      */
+    bool push_back(T&& new_element) {
+        return emplace_back(std::move(new_element));
+    }
+
+    /** Constructs an element in place at the end of the array
+      * If there's not enough memory for a new element, a new zone will be allocated
+      * @param args arguments for the constructor of T
+      * @returns true if the element was added, false otherwise (out of memory)
+      */
+    template<typename... Args>
+    bool emplace_back(Args&&... args) {
+        uint32_t idx;
+        if (!reserve_slots(1, &idx)) {
+            return false;
+        }
+        new(get_slot_address(idx)) T(std::forward<Args>(args)...);
+        publish(1);
+        return true;
+    }
+#endif
+
+    /** Adds 'n' elements at the end of the array
+      * The elements are added in a single step (they are contiguous in the array and become
+      * visible at the same time). If there's not enough memory for them, a single new zone
+      * will be allocated.
+      * @param first pointer to the first element to add
+      * @param n number of elements to add
+      * @returns true if the elements were added, false otherwise (out of memory)
+      */
+    bool append(const T* first, size_t n) {
+        uint32_t idx;
+        if (n == 0) {
+            return true;
+        }
+        if (!reserve_slots(n, &idx)) {
+            return false;
+        }
+        // Copy the elements, one contiguous run per zone
+        size_t left = n;
+        while (left > 0) {
+            const zone_directory *dir = _directory;
+            const array_zone& zone = dir->zones[find_zone(dir, idx)];
+            size_t run = zone.first_idx + zone.capacity - idx;
+            if (run > left) {
+                run = left;
             }
-            {
-                CriticalSectionLock lock;
-                if (prev_capacity == _capacity) { // allocate only if someone else didn't
-                    if((_head = create_new_array(_grow_capacity, _elements, _head)) == NULL) {
-                        return false;
-                    }
-                    _capacity += _grow_capacity;
+            uint8_t *dest = zone.data + _element_size * (idx - zone.first_idx);
+            if (MBED_UTIL_ARRAY_IS_TRIVIALLY_COPYABLE(T) && (_element_size == sizeof(T))) {
+                memcpy(dest, first, run * sizeof(T));
+            } else {
+                for (size_t i = 0; i < run; i ++, dest += _element_size) {
+                    new(dest) T(first[i]);
                 }
             }
+            first += run;
+            idx += run;
+            left -= run;
         }
-        {
-            // TODO: this will eventually be 'atomic_set(&_elements);' after we figure
-            // out the atomic access primitives
-            CriticalSectionLock lock;
-            _elements ++;
-        }
-        new(get_element_address(idx)) T(new_element);
+        publish(n);
         return true;
     }
 
     /** Removes the last element in the array
+      * This must not be called concurrently with push_back.
       */
     void pop_back() {
         T *p = NULL;
         {
-            CriticalSectionLock lock;
+            lock_guard lock(_lock);
             if (_elements > 0) {
                 p = get_element_address(_elements - 1);
                 --_elements;
+                --_reserved;
+                --_completed;
             }
         }
         if (p != NULL) {
@@ -169,18 +285,26 @@ public:
         }
     }
 
+    /** Removes all the elements in the array. The memory of the array is kept.
+      * This must not be called concurrently with push_back.
+      */
+    void clear() {
+        unsigned elements;
+        {
+            lock_guard lock(_lock);
+            elements = _elements;
+            _elements = _reserved = _completed = 0;
+        }
+        for (unsigned i = 0; i < elements; i ++) {
+            get_slot_address(i)->~T();
+        }
+    }
+
     /** Return the number of zones (linked memory areas) in this array
       * @returns number of zones
       */
     unsigned get_num_zones() const {
-        unsigned cnt = 0;
-        array_link *crt = _head;
-
-        while (crt != NULL) {
-            cnt ++;
-            crt = crt->prev;
-        }
-        return cnt;
+        return _directory == NULL ? 0 : _directory->num_zones;
     }
 
     /** Returns the number of elements in the array
@@ -198,44 +322,163 @@ public:
     }
 
 private:
-    struct array_link {
-        array_link(void *_data, unsigned _first_idx, array_link *_prev):
-            data((uint8_t*)_data),
-            first_idx(_first_idx),
-            prev(_prev) {
-        }
-
+    struct array_zone {
         uint8_t *data;
         unsigned first_idx;
-        array_link *prev;
+        unsigned capacity;
     };
 
-    array_link *create_new_array(size_t elements, unsigned first_idx = 0, array_link *prev = NULL) const {
-        // Create the array space + an array_link structure in the same contigous memory area
-        // Layout: array storage area | array_link structure
-        // Since the array elements are aligned to at least 4 bytes, the array_link address will be correctly aligned
-        size_t array_storage_size = _element_size * elements;
-        void *temp = mbed_ualloc(array_storage_size + sizeof(array_link), _alloc_traits);
-        if (temp == NULL)
-            return NULL;
-        array_link *p = new((char*)temp + array_storage_size) array_link(temp, first_idx, prev);
-        return p;
+    // Directory of zones, in index order
+    struct zone_directory {
+        zone_directory *retired;    // previous (smaller) directory, freed in the destructor
+        unsigned capacity;
+        volatile unsigned num_zones;
+        array_zone zones[1];        // 'capacity' entries
+    };
+
+    bool add_zone(size_t elements) {
+        zone_directory *dir = _directory;
+        unsigned n = dir == NULL ? 0 : dir->num_zones;
+
+        uint8_t *data = (uint8_t*)mbed_ualloc(_element_size * elements, _alloc_traits);
+        if (data == NULL)
+            return false;
+        if ((dir == NULL) || (n == dir->capacity)) {
+            // Create a larger directory. The old one might still be used by a concurrent
+            // reader, so it is only freed in the destructor.
+            unsigned capacity = dir == NULL ? 4 : dir->capacity * 2;
+            zone_directory *new_dir = (zone_directory*)mbed_ualloc(sizeof(zone_directory) + (capacity - 1) * sizeof(array_zone), _alloc_traits);
+            if (new_dir == NULL) {
+                mbed_ufree(data);
+                return false;
+            }
+            new_dir->retired = dir;
+            new_dir->capacity = capacity;
+            for (unsigned i = 0; i < n; i ++) {
+                new_dir->zones[i] = dir->zones[i];
+            }
+            new_dir->num_zones = n;
+            _directory = dir = new_dir;
+        }
+        // Check if the zones still follow one of the layouts that can be indexed directly
+        if (n == 1) {
+            _zone_size = elements;
+        } else if ((n > 1) && (elements != _zone_size)) {
+            _uniform = false;
+        }
+        if ((n > 0) && (elements != _capacity)) {
+            _doubling = false;
+        }
+        dir->zones[n].data = data;
+        dir->zones[n].first_idx = _capacity;
+        dir->zones[n].capacity = elements;
+        dir->num_zones = n + 1;
+        return true;
+    }
+
+    static unsigned msb_index(unsigned n) {
+#if defined(__GNUC__) || defined(__clang__)
+        return sizeof(unsigned) * 8 - 1 - __builtin_clz(n);
+#else
+        unsigned idx = 0;
+        while (n >>= 1) {
+            idx ++;
+        }
+        return idx;
+#endif
     }
 
-    T *get_element_address(unsigned idx) const {
-        array_link *crt = _head;
+    unsigned find_zone(const zone_directory *dir, unsigned idx) const {
+        if (idx < _first_zone_size) {
+            return 0;
+        }
+        if (_doubling) {
+            // Zone k (k >= 1) starts at index _first_zone_size * 2^(k - 1)
+            return 1 + msb_index(idx / _first_zone_size);
+        }
+        if (_uniform) {
+            return 1 + (idx - _first_zone_size) / _zone_size;
+        }
+        // Binary search for the last zone that starts at or before 'idx'
+        unsigned low = 1, high = dir->num_zones;
+        while (high - low > 1) {
+            unsigned mid = low + (high - low) / 2;
+            if (dir->zones[mid].first_idx <= idx) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    T *get_slot_address(unsigned idx) const {
+        const zone_directory *dir = _directory;
+        const array_zone& zone = dir->zones[find_zone(dir, idx)];
+        return (T*)(zone.data + _element_size * (idx - zone.first_idx));
+    }
 
+    T *get_element_address(unsigned idx) const {
         CORE_UTIL_ASSERT(idx < _elements);
-        // first_idx in the first allocated array is 0, so the loop below is guaranteed to end
-        while(idx < crt->first_idx) {
-            crt = crt->prev;
+        return get_slot_address(idx);
+    }
+
+    // Reserve 'n' contiguous slots, growing the array first if needed. Slots are reserved
+    // only if they exist, so failing to grow doesn't leave a hole in the array.
+    bool reserve_slots(uint32_t n, uint32_t *idx) {
+        *idx = _reserved;
+        if (LockTraits<Lock>::single_context) {
+            if ((*idx + n > _capacity) && !grow(*idx + n)) {
+                return false;
+            }
+            _reserved = *idx + n;
+            return true;
+        }
+        do {
+            if ((*idx + n > _capacity) && !grow(*idx + n)) {
+                return false;
+            }
+        } while (!atomic_cas(&_reserved, idx, *idx + n));
+        return true;
+    }
+
+    // Make sure that the array has at least 'capacity' slots. At most one zone is added.
+    bool grow(size_t capacity) {
+        lock_guard lock(_lock);
+        if (capacity <= _capacity) { // someone else already allocated a new zone
+            return true;
+        }
+        size_t grow_capacity = _growth.get_increment(_capacity);
+        if (grow_capacity == 0) { // can we grow?
+            return false;
+        }
+        if (grow_capacity < capacity - _capacity) {
+            grow_capacity = capacity - _capacity;
+        }
+        if (!add_zone(grow_capacity)) {
+            return false;
+        }
+        _capacity += grow_capacity;
+        return true;
+    }
+
+    // Called after constructing 'n' elements in reserved slots
+    void publish(uint32_t n) {
+        if (LockTraits<Lock>::single_context) {
+            _elements = _completed = _completed + n;
+            return;
+        }
+        uint32_t completed = atomic_incr(&_completed, n);
+        // If all the reserved slots are constructed, make them visible. Otherwise the
+        // last push_back that completes will do it.
+        if (completed == _reserved) {
+            uint32_t elements = _elements;
+            while ((elements < completed) && !atomic_cas((uint32_t*)&_elements, &elements, completed));
         }
-        CORE_UTIL_ASSERT(crt != NULL);
-        return (T*)(crt->data + _element_size * (idx - crt->first_idx));
     }
 
     void check_access(unsigned idx) const {
-        if (NULL == _head) {
+        if (NULL == _directory) {
             CORE_UTIL_RUNTIME_ERROR("Attempt to use uninitialized Array %p\r\n", this);
         }
         if (idx >= _elements) {
@@ -243,11 +486,19 @@ private:
         }
     }
 
-    array_link *volatile _head;
+    zone_directory *volatile _directory;
+    typename LockTraits<Lock>::lock_type _lock;
     UAllocTraits_t _alloc_traits;
-    size_t _element_size, _grow_capacity;
-    volatile unsigned _capacity, _elements;
+    size_t _element_size;
+    GrowthPolicy _growth;
+    volatile unsigned _capacity;
+    // Number of visible elements, reserved slots and constructed elements
+    volatile uint32_t _elements;
+    uint32_t _reserved, _completed;
     unsigned _alignment;
+    // Layout of the zones, used to find the zone of an index without a search
+    size_t _first_zone_size, _zone_size;
+    volatile bool _uniform, _doubling;
 };
 
 } // namespace util
@@ -0,0 +1,384 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_ATOMIC_H__
+#define __MBED_UTIL_ATOMIC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/atomic_ops.h"
+
+namespace mbed {
+namespace util {
+
+/** Memory ordering constraints of the operations of Atomic (with the same meaning as in
+  * C++11). With the compiler's __atomic builtins, the values are the builtins' own.
+  */
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+enum memory_order {
+    memory_order_relaxed = __ATOMIC_RELAXED,
+    memory_order_acquire = __ATOMIC_ACQUIRE,
+    memory_order_release = __ATOMIC_RELEASE,
+    memory_order_acq_rel = __ATOMIC_ACQ_REL,
+    memory_order_seq_cst = __ATOMIC_SEQ_CST
+};
+#else
+enum memory_order {
+    memory_order_relaxed,
+    memory_order_acquire,
+    memory_order_release,
+    memory_order_acq_rel,
+    memory_order_seq_cst
+};
+#endif
+
+/** A memory fence with the given ordering
+  * @param order memory_order_relaxed is a no-op, the other orders are full fences
+  *        (except with the __atomic builtins, which can use cheaper fences)
+  */
+inline void atomic_fence(memory_order order) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+    __atomic_thread_fence(order);
+#else
+    if (order == memory_order_relaxed)
+        return;
+#if defined(TARGET_LIKE_POSIX) && (defined(__GNUC__) || defined(__clang__))
+    __sync_synchronize();
+#elif !defined(TARGET_LIKE_POSIX)
+    __DMB();
+#endif
+#endif
+}
+
+/** Base of Atomic: the operations that are common to integers and pointers
+  */
+template<typename T>
+class AtomicBase {
+public:
+    /** Read the value
+      * @param order memory_order_relaxed, memory_order_acquire or memory_order_seq_cst
+      * @returns the value
+      */
+    T load(memory_order order = memory_order_seq_cst) const {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_load_n(&_value, order);
+#else
+        T value;
+        if (sizeof(T) > sizeof(uint32_t)) {
+            // Not a single access: read it with a compare-and-swap, which also writes back
+            // the value it found if it's equal to 'value'
+            value = T();
+            atomic_cas(const_cast<T*>(&_value), &value, value);
+            return value;
+        }
+        if (order == memory_order_seq_cst)
+            atomic_fence(order);
+        value = *(const volatile T*)&_value;
+        if (order != memory_order_relaxed)
+            atomic_fence(order);
+        return value;
+#endif
+    }
+
+    /** Write the value
+      * @param value the new value
+      * @param order memory_order_relaxed, memory_order_release or memory_order_seq_cst
+      */
+    void store(T value, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        __atomic_store_n(&_value, value, order);
+#else
+        if (sizeof(T) > sizeof(uint32_t)) {
+            exchange(value, order);
+            return;
+        }
+        if (order != memory_order_relaxed)
+            atomic_fence(order);
+        *(volatile T*)&_value = value;
+        if (order == memory_order_seq_cst)
+            atomic_fence(order);
+#endif
+    }
+
+    /** Replace the value
+      * @param value the new value
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T exchange(T value, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_exchange_n(&_value, value, order);
+#else
+        (void)order;
+        T current = load(memory_order_relaxed);
+        while (!atomic_cas(&_value, &current, value));
+        return current;
+#endif
+    }
+
+    /** Replace the value if it is equal to 'expected'
+      * @param expected the expected value. If it is not equal to the current value, it is
+      *        updated with the current value.
+      * @param desired the new value
+      * @param success memory order if the value is replaced
+      * @param failure memory order if the value is not replaced (memory_order_relaxed,
+      *        memory_order_acquire or memory_order_seq_cst, not stronger than 'success')
+      * @returns true if the value was replaced, false otherwise
+      */
+    bool compare_exchange_strong(T& expected, T desired, memory_order success, memory_order failure) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_compare_exchange_n(&_value, &expected, desired, false, success, failure);
+#else
+        (void)success;
+        (void)failure;
+        // The LDREX/STREX specializations of atomic_cas can fail spuriously. Retry until
+        // the CAS succeeds or the current value really differs from 'expected'.
+        const T original = expected;
+        while (!atomic_cas(&_value, &expected, desired)) {
+            if (!(expected == original))
+                return false;
+        }
+        return true;
+#endif
+    }
+
+    /** Replace the value if it is equal to 'expected'
+      * The memory order if the value is not replaced is derived from 'order'.
+      */
+    bool compare_exchange_strong(T& expected, T desired, memory_order order = memory_order_seq_cst) {
+        return compare_exchange_strong(expected, desired, order, _failure_order(order));
+    }
+
+    /** Like compare_exchange_strong, but it can fail even if the value is equal to 'expected'
+      * (on architectures with load-linked/store-conditional instructions). Use it in loops.
+      */
+    bool compare_exchange_weak(T& expected, T desired, memory_order success, memory_order failure) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_compare_exchange_n(&_value, &expected, desired, true, success, failure);
+#else
+        (void)success;
+        (void)failure;
+        return atomic_cas(&_value, &expected, desired);
+#endif
+    }
+
+    /** Like compare_exchange_strong, but it can fail even if the value is equal to 'expected'
+      * The memory order if the value is not replaced is derived from 'order'.
+      */
+    bool compare_exchange_weak(T& expected, T desired, memory_order order = memory_order_seq_cst) {
+        return compare_exchange_weak(expected, desired, order, _failure_order(order));
+    }
+
+    /** Read the value (with memory_order_seq_cst)
+      */
+    operator T() const {
+        return load();
+    }
+
+protected:
+    AtomicBase(T value): _value(value) {
+    }
+
+    static memory_order _failure_order(memory_order order) {
+        if (order == memory_order_acq_rel)
+            return memory_order_acquire;
+        if (order == memory_order_release)
+            return memory_order_relaxed;
+        return order;
+    }
+
+    T _value;
+
+private:
+    // Atomic objects can't be copied
+    AtomicBase(const AtomicBase&);
+    AtomicBase& operator =(const AtomicBase&);
+};
+
+/** An atomic integer, with an explicit memory order for each operation
+  *
+  * Unlike the atomic_ops functions, which are always full barriers, each operation takes
+  * the weakest memory order that is correct for the caller: for example, a statistics
+  * counter can be incremented with memory_order_relaxed, and a flag that publishes data
+  * can be written with memory_order_release and read with memory_order_acquire. The default
+  * order is memory_order_seq_cst, like in C++11.
+  *
+  * With the compiler's __atomic builtins (see atomic_ops.h), the operations map directly to
+  * them. Otherwise, the read-modify-write operations are built on atomic_cas and the memory
+  * orders other than memory_order_relaxed add full fences.
+  *
+  * Usage example:
+  *
+  * @code
+  * Atomic<uint32_t> counter(0);
+  * counter.fetch_add(1, memory_order_relaxed);
+  *
+  * Atomic<uint32_t> ready(0);
+  * data = compute();                           // producer
+  * ready.store(1, memory_order_release);
+  * ...
+  * if (ready.load(memory_order_acquire))       // consumer
+  *     use(data);
+  * @endcode
+  */
+template<typename T>
+class Atomic: public AtomicBase<T> {
+    using AtomicBase<T>::_value;
+
+public:
+    /** Create a new atomic integer
+      * @param value the initial value
+      */
+    Atomic(T value = T()): AtomicBase<T>(value) {
+    }
+
+    /** Add to the value
+      * @param delta the value to add
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T fetch_add(T delta, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_fetch_add(&_value, delta, order);
+#else
+        (void)order;
+        return atomic_incr(&_value, delta) - delta;
+#endif
+    }
+
+    /** Subtract from the value
+      * @param delta the value to subtract
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T fetch_sub(T delta, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_fetch_sub(&_value, delta, order);
+#else
+        (void)order;
+        return atomic_decr(&_value, delta) + delta;
+#endif
+    }
+
+    /** Bitwise AND the value
+      * @param mask the operand
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T fetch_and(T mask, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_fetch_and(&_value, mask, order);
+#else
+        (void)order;
+        T current = this->load(memory_order_relaxed);
+        while (!atomic_cas(&_value, &current, (T)(current & mask)));
+        return current;
+#endif
+    }
+
+    /** Bitwise OR the value
+      * @param mask the operand
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T fetch_or(T mask, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_fetch_or(&_value, mask, order);
+#else
+        (void)order;
+        T current = this->load(memory_order_relaxed);
+        while (!atomic_cas(&_value, &current, (T)(current | mask)));
+        return current;
+#endif
+    }
+
+    /** Bitwise XOR the value
+      * @param mask the operand
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T fetch_xor(T mask, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        return __atomic_fetch_xor(&_value, mask, order);
+#else
+        (void)order;
+        T current = this->load(memory_order_relaxed);
+        while (!atomic_cas(&_value, &current, (T)(current ^ mask)));
+        return current;
+#endif
+    }
+
+    /** Write the value (with memory_order_seq_cst)
+      */
+    Atomic& operator =(T value) {
+        this->store(value);
+        return *this;
+    }
+};
+
+/** An atomic pointer. fetch_add and fetch_sub move the pointer by a number of elements,
+  * like pointer arithmetic.
+  */
+template<typename T>
+class Atomic<T*>: public AtomicBase<T*> {
+    using AtomicBase<T*>::_value;
+
+public:
+    /** Create a new atomic pointer
+      * @param value the initial value
+      */
+    Atomic(T *value = NULL): AtomicBase<T*>(value) {
+    }
+
+    /** Move the pointer forward
+      * @param n number of elements
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T *fetch_add(ptrdiff_t n, memory_order order = memory_order_seq_cst) {
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+        // The builtins don't scale the operand for pointers
+        return __atomic_fetch_add(&_value, n * sizeof(T), order);
+#else
+        (void)order;
+        T *current = this->load(memory_order_relaxed);
+        while (!atomic_cas(&_value, &current, current + n));
+        return current;
+#endif
+    }
+
+    /** Move the pointer backward
+      * @param n number of elements
+      * @param order any memory order
+      * @returns the previous value
+      */
+    T *fetch_sub(ptrdiff_t n, memory_order order = memory_order_seq_cst) {
+        return fetch_add(-n, order);
+    }
+
+    /** Write the value (with memory_order_seq_cst)
+      */
+    Atomic& operator =(T *value) {
+        this->store(value);
+        return *this;
+    }
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_ATOMIC_H__
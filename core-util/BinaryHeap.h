@@ -20,8 +20,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
-#include "core-util/CriticalSectionLock.h"
 #include "core-util/Array.h"
+#include "core-util/LockPolicy.h"
 #include "ualloc/ualloc.h"
 #include <stdio.h>
 
@@ -31,6 +31,15 @@
   *
   * Becuase it uses an Array, it can grow automatically to accomodate more elements.
   *
+  * The number of children of each node (the arity of the heap) is a template parameter
+  * (2 by default). A larger arity makes the heap shallower, so fewer levels are visited
+  * when an element is moved down (pop_root/remove_root), at the price of more comparisons
+  * per level. Node i has children Arity * i + 1 ... Arity * i + Arity, which are adjacent
+  * in memory.
+  *
+  * The heap is protected by a lock given by the 'Lock' template parameter (CriticalSectionLock
+  * by default, see LockPolicy.h for the other policies).
+  *
   * The elements are sorted according to a user supplied comparison function, which is
   * implemented in a comparator class. Default versions for both min-heaps (MinCompare)
   * and max-heaps (MaxCompare) are provided as part of the implementation.
@@ -52,6 +61,8 @@
   *     // The MinCompare/MaxCompare classes can be used for classes/structure as
   *     // long as they provide 'operator >=' or 'operator <=' respectively
   *     BinaryHeap<A, MinCompare<A> > minh_a;
+  *     BinaryHeap<int, MinCompare<int>, 4> minh_4; // 4-ary min-heap
+  *     BinaryHeap<int, MinCompare<int>, 2, NullLock> minh_local; // not shared between contexts
   * }
   * @endcode
   */
@@ -88,8 +99,11 @@ public:
     }
 };
 
-template <typename T, typename Comparator=MinCompare<T> >
+template <typename T, typename Comparator=MinCompare<T>, unsigned Arity=2, typename Lock=CriticalSectionLock>
 class BinaryHeap {
+    typedef char arity_must_be_at_least_2[(Arity >= 2) ? 1 : -1];
+    typedef typename LockTraits<Lock>::guard lock_guard;
+
 public:
     /** Construct a new binary heap
       */
@@ -108,12 +122,19 @@ public:
         return _array.init(initial_capacity, grow_capacity, alloc_traits, alignment);
     }
 
+    /** Change the policy used to grow the heap (see Array::set_growth_policy)
+      * @param growth the new growth policy
+      */
+    void set_growth_policy(const GrowthPolicy& growth) {
+        _array.set_growth_policy(growth);
+    }
+
     /** Inserts an element in the heap
       * @param p the element to insert
       * @returns true for success, false for failure (out of memory)
       */
     bool insert(const T& p) {
-        CriticalSectionLock lock;
+        lock_guard lock(_lock);
         if (!_array.push_back(p))
             return false;
         if (++_elements > 1) {
@@ -122,6 +143,58 @@ public:
         return true;
     }
 
+#ifdef CORE_UTIL_HAS_RVALUE_REFERENCES
+    /** Inserts an element in the heap, moving it instead of copying it
+      * @param p the element to insert
+      * @returns true for success, false for failure (out of memory)
+      */
+    bool insert(T&& p) {
+        return emplace(std::move(p));
+    }
+
+    /** Constructs an element in place and inserts it in the heap
+      * @param args arguments for the constructor of T
+      * @returns true for success, false for failure (out of memory)
+      */
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        lock_guard lock(_lock);
+        if (!_array.emplace_back(std::forward<Args>(args)...))
+            return false;
+        if (++_elements > 1) {
+            _propagate_up(_elements - 1);
+        }
+        return true;
+    }
+#endif
+
+    /** Inserts 'n' elements in the heap
+      * The elements are appended to the heap in a single step. If they are more than the
+      * elements already in the heap, the whole heap is rebuilt bottom-up (Floyd's algorithm,
+      * O(total number of elements)). Otherwise each new element is moved up to its position.
+      * @param first pointer to the first element to insert
+      * @param n number of elements to insert
+      * @returns true for success, false for failure (out of memory). If the call fails, the
+      *          heap is not changed.
+      */
+    bool insert_n(const T* first, size_t n) {
+        lock_guard lock(_lock);
+        return _insert_n(first, n);
+    }
+
+    /** Replace the content of the heap with 'n' elements, building the heap in O(n)
+      * @param first pointer to the first element
+      * @param n number of elements
+      * @returns true for success, false for failure (out of memory). If the call fails,
+      *          the heap is empty.
+      */
+    bool build(const T* first, size_t n) {
+        lock_guard lock(_lock);
+        _array.clear();
+        _elements = 0;
+        return _insert_n(first, n);
+    }
+
     /** Returns a copy of the element in the root of the heap
       * @returns copy of the root
       */
@@ -139,9 +212,9 @@ public:
          if (_elements == 0) {
             CORE_UTIL_RUNTIME_ERROR("get_root() called on an empty BinaryHeap");
         }
-        CriticalSectionLock lock;
-        T temp = _array[0];
-        remove_root();
+        lock_guard lock(_lock);
+        T temp(CORE_UTIL_MOVE(_array[0]));
+        _remove_root();
         return temp;
     }
 
@@ -151,14 +224,8 @@ public:
     void remove_root() {
         if (_elements == 0)
             return;
-        {
-            CriticalSectionLock lock;
-            _swap(0, --_elements); // element 0 will be destroyed by 'pop_back()' below
-            _array.pop_back();
-            if (_elements > 1) {
-                _propagate_down(0);
-            }
-        }
+        lock_guard lock(_lock);
+        _remove_root();
     }
 
     /** Checks if the heap is empty
@@ -177,7 +244,7 @@ public:
         if (_elements == 0)
             return false;
         {
-            CriticalSectionLock lock;
+            lock_guard lock(_lock);
             size_t i;
             for (i = 0; i < _elements; i ++) {
                 if (e == _array[i])
@@ -185,10 +252,18 @@ public:
             }
             if (i == _elements)
                 return false;
-            _swap(i, --_elements); // element i will be destroyed by 'pop_back()' below
+            if (i != --_elements) {
+                // Move the last element in place of i, the last slot is destroyed by 'pop_back()' below
+                _array[i] = CORE_UTIL_MOVE(_array[_elements]);
+            }
             _array.pop_back();
-            if (_elements > 1)
-                _propagate_down(i);
+            if (i < _elements) {
+                // The element moved in place of i can belong anywhere on its path to the root
+                if ((i > 0) && !_comparator(_array[_parent(i)], _array[i]))
+                    _propagate_up(i);
+                else
+                    _propagate_down(i);
+            }
             return true;
         }
     }
@@ -199,12 +274,12 @@ public:
     bool is_consistent(size_t node = 0) const {
         if (node >= _elements)
             return true;
-        size_t left = _left(node), right = _right(node);
-        if ((left < _elements) && !_comparator(_array[node], _array[left]))
-            return false;
-        if ((right < _elements) && !_comparator(_array[node], _array[right]))
-            return false;
-       return is_consistent(left) && is_consistent(right);
+        size_t first = _first_child(node);
+        for (size_t child = first; (child < first + Arity) && (child < _elements); child ++) {
+            if (!_comparator(_array[node], _array[child]) || !is_consistent(child))
+                return false;
+        }
+        return true;
     }
 
     /** Returns the number of elements in the heap
@@ -215,67 +290,103 @@ public:
     }
 
 private:
-    size_t _left(size_t i) const {
-        return 2 * i + 1;
+    void _remove_root() {
+        if (--_elements > 0) {
+            // Move the last element to the root, the last slot is destroyed by 'pop_back()' below
+            _array[0] = CORE_UTIL_MOVE(_array[_elements]);
+        }
+        _array.pop_back();
+        if (_elements > 1) {
+            _propagate_down(0);
+        }
     }
 
-    size_t _right(size_t i) const {
-        return 2 * i + 2;
+    bool _insert_n(const T* first, size_t n) {
+        size_t old_elements = _elements;
+        if (!_array.append(first, n))
+            return false;
+        _elements = old_elements + n;
+        if (n > old_elements) {
+            _heapify();
+        } else {
+            for (size_t i = old_elements; i < _elements; i ++)
+                _propagate_up(i);
+        }
+        return true;
+    }
+
+    size_t _first_child(size_t i) const {
+        return Arity * i + 1;
     }
 
     size_t _parent(size_t i) const {
-        return (i - 1) / 2;
+        return (i - 1) / Arity;
+    }
+
+    void _heapify() {
+        // Floyd's algorithm: move each internal node down, starting from the last one.
+        // Most nodes are close to the bottom of the heap, so this is linear in '_elements'.
+        if (_elements < 2)
+            return;
+        for (size_t node = _parent(_elements - 1) + 1; node > 0; node --)
+            _propagate_down(node - 1);
     }
 
     void _propagate_up(size_t node) {
         // This is called when a node is added in the last position in the heap
         // We might need to move the node up towards the parent until the heap property
-        // is satisfied
-        size_t parent = _parent(node);
-        // Move the node up until it satisfies the heap property
-        while ((node > 0) && _comparator(_array[node], _array[parent])) {
-            _swap(node, parent);
+        // is satisfied. Instead of swapping the node with its parent at each level, the node
+        // is lifted out of the heap once, the parents are moved down into the hole that it
+        // leaves and the node is written back once, in its final position.
+        if (node == 0)
+            return;
+        T moving(CORE_UTIL_MOVE(_array[node]));
+        while (node > 0) {
+            size_t parent = _parent(node);
+            T& parent_ref = _array[parent];
+            if (!_comparator(moving, parent_ref))
+                break;
+            _array[node] = CORE_UTIL_MOVE(parent_ref);
             node = parent;
-            parent = _parent(node);
         }
+        _array[node] = CORE_UTIL_MOVE(moving);
     }
 
     void _propagate_down(size_t node) {
         // This is called when an existing node is removed
         // When that happens, it is replaced with the node at the last position in the heap
         // Since that might make the heap inconsistent, we need to move the node down if its
-        // value does not respect the comparison function when compared with its left and
-        // right children.
+        // value does not respect the comparison function when compared with its children.
+        // Like in '_propagate_up', the node is moved only once: its children are moved up
+        // into the hole until the node's final position is found.
+        const size_t elements = _elements;
+        T moving(CORE_UTIL_MOVE(_array[node]));
         while (true) {
-            size_t left = _left(node), right = _right(node), temp;
-            bool change_left = (left < _elements) && !_comparator(_array[node], _array[left]);
-            bool change_right = (right < _elements) && !_comparator(_array[node], _array[right]);
-            if (change_left && change_right) {
-                // If both left/right should change, use the comparison function to figure out
-                // which way to go
-                temp = _comparator(_array[left], _array[right]) ? left : right;
-            } else if (change_left) {
-                temp = left;
-            } else if (change_right) {
-                temp = right;
-            } else {
+            size_t child = _first_child(node), last = child + Arity;
+            if (child >= elements)
                 break;
+            if (last > elements)
+                last = elements;
+            // Use the comparison function to figure out which child could replace the node
+            T *child_ptr = &_array[child];
+            for (size_t other = child + 1; other < last; other ++) {
+                T& other_ref = _array[other];
+                if (!_comparator(*child_ptr, other_ref)) {
+                    child = other;
+                    child_ptr = &other_ref;
+                }
             }
-            _swap(node, temp);
-            node = temp;
-        }
-    }
-
-    void _swap(size_t pos1, size_t pos2) {
-        if (pos1 != pos2) {
-            T temp = _array[pos1];
-            _array[pos1] = _array[pos2];
-            _array[pos2] = temp;
+            if (_comparator(moving, *child_ptr))
+                break;
+            _array[node] = CORE_UTIL_MOVE(*child_ptr);
+            node = child;
         }
+        _array[node] = CORE_UTIL_MOVE(moving);
     }
 
-    Array<T> _array;
+    Array<T, Lock> _array;
     Comparator _comparator;
+    typename LockTraits<Lock>::lock_type _lock;
     volatile size_t _elements;
 };
 
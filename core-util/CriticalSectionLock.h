@@ -46,6 +46,23 @@ namespace util {
   *     // interrupts will be restored to their previous state
   * }
   * @endcode
+  *
+  * On POSIX targets, signals play the role of interrupts. Blocking them with sigprocmask
+  * costs two system calls per critical section, so instead each thread keeps a nesting
+  * counter in thread-local storage and the signals are deferred: a signal handler that
+  * must not run in a critical section starts with
+  *
+  * @code
+  * void handler(int signum) {
+  *     if (CriticalSectionLock::defer_signal(signum))
+  *         return;
+  *     // The thread that received the signal is not in a critical section
+  * }
+  * @endcode
+  *
+  * A deferred signal is raised again when its thread leaves the outermost critical
+  * section, so entering and leaving a critical section doesn't need any system call.
+  * Signal handlers that don't call 'defer_signal' run even in critical sections.
   */
 class CriticalSectionLock {
 public:
@@ -53,16 +70,7 @@ public:
 #ifdef TARGET_NORDIC
         sd_nvic_critical_region_enter(&_state);
 #elif defined(TARGET_LIKE_POSIX)
-        if (++IRQNestingDepth > 1) {
-            return;
-        }
-
-        int rc;
-        sigset_t fullSet;
-        rc = sigfillset(&fullSet);
-        assert(rc == 0);
-        rc = sigprocmask(SIG_BLOCK, &fullSet, &oldSigSet);
-        assert(rc == 0);
+        _depth = _depth + 1;
 #else
         _state = __get_PRIMASK();
         __disable_irq();
@@ -73,22 +81,46 @@ public:
 #ifdef TARGET_NORDIC
         sd_nvic_critical_region_exit(_state);
 #elif defined(TARGET_LIKE_POSIX)
-        assert(IRQNestingDepth > 0);
-        if (--IRQNestingDepth == 0) {
-            int rc = sigprocmask(SIG_SETMASK, &oldSigSet, NULL);
-            assert(rc == 0);
+        assert(_depth > 0);
+        // A signal that arrives after '_depth' is written back as 0 runs immediately,
+        // an earlier one is seen in '_pending' below
+        _depth = _depth - 1;
+        if ((_depth == 0) && _pending) {
+            _raise_deferred_signals();
         }
 #else
         __set_PRIMASK(_state);
 #endif
     }
 
+#ifdef TARGET_LIKE_POSIX
+    /** Check if the calling thread is in a critical section (POSIX only)
+      * @returns true if the calling thread is in a critical section, false otherwise
+      */
+    static bool in_critical_section() {
+        return _depth > 0;
+    }
+
+    /** Defer a signal if the thread that received it is in a critical section (POSIX only)
+      * This is meant to be called at the start of a signal handler. If it returns true,
+      * the handler must return immediately: the signal will be raised again when the
+      * thread leaves its outermost critical section.
+      * @param signum the number of the signal
+      * @returns true if the signal was deferred, false if the handler can run
+      */
+    static bool defer_signal(int signum);
+#endif
+
 private:
 #ifdef TARGET_NORDIC
     uint8_t  _state;
 #elif defined(TARGET_LIKE_POSIX)
-    unsigned IRQNestingDepth;
-    sigset_t oldSigSet;
+    static void _raise_deferred_signals();
+
+    // Nesting depth of the critical sections of the current thread
+    static __thread volatile unsigned _depth;
+    // Set when the current thread has deferred signals
+    static __thread volatile sig_atomic_t _pending;
 #else
     uint32_t _state;
 #endif
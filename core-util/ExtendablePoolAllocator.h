@@ -19,7 +19,10 @@
 #define __MBED_UTIL_EXTENDABLE_POOL_ALLOCATOR_H__
 
 #include <stddef.h>
+#include <stdint.h>
 #include "core-util/PoolAllocator.h"
+#include "core-util/GrowthPolicy.h"
+#include "core-util/LockPolicy.h"
 #include "ualloc/ualloc.h"
 
 namespace mbed {
@@ -31,19 +34,36 @@ namespace util {
   *
   * ExtendablePoolAllocator starts with a single PoolAllocator. Allocation is first
   * attempted from the most recent pool; if that fails, allocation is attempted again
-  * from the other pools. If that fails, a new pool is created (with a number of elements
-  * specified by 'set_new_pool_size' and allocation is attempted from this new pool
+  * from the other pools that have free elements (the allocator keeps a list of these pools,
+  * so full pools are skipped). If that fails, a new pool is created (with a number of elements
+  * given by the growth policy, see 'set_growth_policy') and allocation is attempted from this
+  * new pool
+  *
+  * To find the pool that owns an element in free(), the allocator keeps a directory of
+  * its pools sorted by address, which is searched with a binary search instead of walking
+  * the whole list of pools.
+  *
+  * The allocator counts the live elements in each pool, so pools that become empty can be
+  * returned to the system allocator (see 'set_trim_policy' and 'trim'). The current pool
+  * (the one that was created last) is never released.
+  *
+  * Creating and releasing pools takes the lock given by the 'Lock' template parameter (see
+  * LockPolicy.h). ExtendablePoolAllocator uses the default CriticalSectionLock. The class is
+  * instantiated in the library for CriticalSectionLock, NullLock, SpinLock, TicketLock and
+  * MCSLock.
   */
+template <typename Lock=CriticalSectionLock>
+class BasicExtendablePoolAllocator {
+    typedef typename LockTraits<Lock>::guard lock_guard;
 
-class ExtendablePoolAllocator {
 public:
     /** Create a new extendable pool allocator
       */
-    ExtendablePoolAllocator();
+    BasicExtendablePoolAllocator();
 
     /** Destructor. It will automatically free all allocated memory
       */
-    ~ExtendablePoolAllocator();
+    ~BasicExtendablePoolAllocator();
 
     /** Initialize the allocator, allocating the first pool
       * @param initial_elements the size of the initial pool in elements (each of element_size bytes)
@@ -57,14 +77,31 @@ public:
       */
     bool init(size_t initial_elements, size_t new_pool_elements, size_t element_size, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN);
 
+    /** Change the policy used to compute the size of new pools (by default, new pools have
+      * 'new_pool_elements' elements, as given to 'init'). The policy receives the total number
+      * of elements in all the pools as the current capacity.
+      * @param growth the new growth policy
+      */
+    void set_growth_policy(const GrowthPolicy& growth);
+
     /** Allocate a new element from the pool
       * It will try to allocate using the most recent pool
-      * Failing that, it will try to allocate from all the other pools
+      * Failing that, it will try to allocate from the other pools that have free elements
       * Failing that, it will try to create a new pool and allocate from it
       * @returns the address of the new element or NULL for error
       */
     void* alloc();
 
+    /** Allocate up to 'n' elements. Each pool provides its elements with a single atomic
+      * operation; the request is spread over several pools (and new pools are created) if
+      * needed to satisfy it.
+      * @param blocks array that receives the addresses of the allocated elements
+      * @param n number of elements to allocate
+      * @returns the number of allocated elements, which is less than 'n' only if new pools
+      *          can't be created. The elements that were allocated must still be freed.
+      */
+    size_t alloc_n(void **blocks, size_t n);
+
     /** Allocate a new element from the pool and initialize it with 0
       * @returns the address of the new element or NULL for error
       */
@@ -75,6 +112,40 @@ public:
       */
     void free(void* p);
 
+    /** Free 'n' previously allocated elements. Consecutive elements that belong to the
+      * same pool are returned to it with a single atomic operation.
+      * @param blocks array with the addresses of the elements
+      * @param n number of elements in 'blocks'
+      */
+    void free_n(void **blocks, size_t n);
+
+    /** Configure how empty pools are returned to the system allocator (with mbed_ufree)
+      * By default, pools are only released by an explicit call to 'trim', and one empty
+      * pool is kept in reserve besides the current pool.
+      * This should be called before the allocator is used from multiple contexts.
+      * @param reserve number of empty pools (besides the current pool) that are kept to
+      *        avoid releasing and creating pools repeatedly
+      * @param auto_trim if true, free() releases the empty pools above the reserve as soon
+      *        as more than 'reserve + 1' pools are empty. This adds an atomic increment and
+      *        decrement to each allocation and free, which count the operations that use
+      *        the pools without the lock. Pools are only released when no such operation
+      *        is in progress, and operations that start while pools are being released
+      *        wait for the lock. Because of that wait, automatic trimming needs a Lock that
+      *        excludes all the contexts that use the allocator: with CriticalSectionLock
+      *        the allocator must only be used from one thread (and interrupt handlers) on a
+      *        single core, and with the spin locks it must not be used from interrupt
+      *        handlers.
+      */
+    void set_trim_policy(size_t reserve, bool auto_trim);
+
+    /** Release the empty pools above the reserve set by 'set_trim_policy' and the memory used
+      * by the old versions of the internal pool directory.
+      * This is meant to be called in a maintenance window: it must not run concurrently
+      * with other operations on this allocator from other threads or interrupt handlers.
+      * @returns the number of released pools
+      */
+    size_t trim();
+
     /** Return the number of PoolAllocator instances in this pool
       * @returns number of PoolAllocator instances
       */
@@ -84,18 +155,67 @@ private:
     struct pool_link {
         pool_link(void *start, size_t elements, size_t element_size, unsigned alignment, pool_link *_prev):
             prev(_prev),
-            allocator(start, elements, element_size, alignment) {
+            allocator(start, elements, element_size, alignment),
+            next_available(NULL),
+            capacity((uint32_t)elements),
+            live(0),
+            available(0) {
         }
 
         pool_link *prev;
         PoolAllocator allocator;
+        pool_link *next_available; // next pool in the list of pools with free elements
+        uint32_t capacity;
+        uint32_t live;      // number of elements allocated from this pool
+        uint32_t available; // 1 if the pool is in the list of pools with free elements
+    };
+    // Directory of pools, sorted by address. Since each pool_link is placed right after the
+    // storage area of its pool, the pool that owns an address is the first pool whose
+    // pool_link is placed after that address.
+    struct pool_directory {
+        pool_directory *retired;    // previous (smaller) directory, freed in the destructor
+        size_t capacity;
+        volatile size_t num_pools;
+        pool_link *pools[1];        // 'capacity' entries
     };
     pool_link *create_new_pool(size_t elements, pool_link *prev) const;
-
+    pool_link *add_new_pool(size_t elements);
+    pool_link *find_pool(void *p) const;
+    void add_to_directory(pool_link *pool);
+    void remove_from_directory(pool_link *pool);
+    void *alloc_internal();
+    size_t alloc_n_internal(void **blocks, size_t n);
+    void *alloc_from(pool_link *pool);
+    size_t alloc_n_from(pool_link *pool, void **blocks, size_t n);
+    void account_alloc(pool_link *pool, size_t n);
+    bool account_free(pool_link *pool, size_t n);
+    bool enter();
+    void leave(bool tracked);
+    size_t release_empty_pools(bool maintenance);
+    void mark_available(pool_link *pool);
+    void link_available(pool_link *pool);
+    void mark_full(pool_link *pool);
+    void unlink_available(pool_link *pool);
+
+    mutable typename LockTraits<Lock>::lock_type _lock; // taken by find_pool() too
     pool_link *volatile _head;
-    size_t _element_size, _new_pool_elements;
+    pool_link *volatile _available;  // list of pools that (probably) have free elements
+    pool_directory *volatile _directory;
+    size_t _element_size;
+    size_t _capacity; // total number of elements in all the pools
+    GrowthPolicy _growth;
     UAllocTraits_t _alloc_traits;
     unsigned _alignment;
+    uint32_t _empty_pools;  // number of pools without live elements
+    uint32_t _active;       // number of operations in progress (only counted with auto trimming)
+    size_t _reserve;
+    bool _auto_trim;
+};
+
+/** ExtendablePoolAllocator with the default lock policy (CriticalSectionLock). It is a class
+  * instead of a typedef, so that it can still be forward declared.
+  */
+class ExtendablePoolAllocator: public BasicExtendablePoolAllocator<CriticalSectionLock> {
 };
 
 } // namespace util
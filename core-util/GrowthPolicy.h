@@ -0,0 +1,107 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_GROWTH_POLICY_H__
+#define __MBED_UTIL_GROWTH_POLICY_H__
+
+#include <stddef.h>
+
+namespace mbed {
+namespace util {
+
+/** Describes how much a growable container (Array, ExtendablePoolAllocator) grows when it
+  * runs out of space.
+  *
+  * Each time the container grows, it adds 'capacity * numerator / denominator' elements
+  * (where 'capacity' is its current capacity), but at least 'min_increment' and at most
+  * 'max_increment' elements. A fixed policy (numerator == 0) creates a number of zones/pools
+  * that is linear in the total size; the geometric policies (doubling, factor of 1.5) keep
+  * it logarithmic until the increment reaches 'max_increment'.
+  *
+  * Usage example:
+  *
+  * @code
+  * Array<int> array;
+  * array.init(16, 16, traits);
+  * // grow by doubling the capacity, but never add more than 4096 elements at once
+  * array.set_growth_policy(GrowthPolicy::doubling(16, 4096));
+  * @endcode
+  */
+class GrowthPolicy {
+public:
+    /** Create a new growth policy
+      * @param min_increment the minimum number of elements added when the container grows
+      *        (if this is 0 and the computed increment is also 0, the container can't grow)
+      * @param numerator numerator of the growth factor applied to the current capacity
+      * @param denominator denominator of the growth factor applied to the current capacity
+      *        (must not be 0; a denominator of 0 is handled like 1)
+      * @param max_increment the maximum number of elements added when the container grows
+      *        (0 for no limit)
+      */
+    GrowthPolicy(size_t min_increment = 0, unsigned numerator = 0, unsigned denominator = 1, size_t max_increment = 0):
+        _min_increment(min_increment), _max_increment(max_increment), _numerator(numerator),
+        _denominator(denominator == 0 ? 1 : denominator) {
+    }
+
+    /** Grow by a fixed number of elements
+      * @param increment number of elements added when the container grows
+      */
+    static GrowthPolicy fixed(size_t increment) {
+        return GrowthPolicy(increment);
+    }
+
+    /** Double the capacity each time the container grows
+      * @param min_increment the minimum number of elements added when the container grows
+      * @param max_increment the maximum number of elements added when the container grows
+      *        (0 for no limit)
+      */
+    static GrowthPolicy doubling(size_t min_increment, size_t max_increment = 0) {
+        return GrowthPolicy(min_increment, 1, 1, max_increment);
+    }
+
+    /** Multiply the capacity by 1.5 each time the container grows
+      * @param min_increment the minimum number of elements added when the container grows
+      * @param max_increment the maximum number of elements added when the container grows
+      *        (0 for no limit)
+      */
+    static GrowthPolicy factor_1_5(size_t min_increment, size_t max_increment = 0) {
+        return GrowthPolicy(min_increment, 1, 2, max_increment);
+    }
+
+    /** Compute the number of elements to add to a container
+      * @param capacity the current capacity of the container
+      * @returns the number of elements to add, or 0 if the container can't grow
+      */
+    size_t get_increment(size_t capacity) const {
+        size_t increment = capacity / _denominator * _numerator + (capacity % _denominator) * _numerator / _denominator;
+        if (increment < _min_increment)
+            increment = _min_increment;
+        if ((_max_increment != 0) && (increment > _max_increment))
+            increment = _max_increment;
+        return increment;
+    }
+
+private:
+    size_t _min_increment, _max_increment;
+    unsigned _numerator, _denominator;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_GROWTH_POLICY_H__
+
@@ -0,0 +1,359 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_INDEXED_BINARY_HEAP_H__
+#define __MBED_UTIL_INDEXED_BINARY_HEAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/CriticalSectionLock.h"
+#include "core-util/LockPolicy.h"
+#include "core-util/Array.h"
+#include "core-util/BinaryHeap.h"
+#include "core-util/core-util.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+/** A reentrant heap that tracks the position of each of its elements
+  *
+  * It works like BinaryHeap, but 'insert' returns a handle for the new element. The handle
+  * stays valid until the element is removed from the heap, and it can be used to remove the
+  * element or to change its value in O(log n), without searching for it (for example, to
+  * cancel or reschedule a timer). After an element is removed, its handle can be returned
+  * again by a later 'insert'.
+  *
+  * The position of each element is kept in a separate table indexed by handle, so this needs
+  * an additional 4 bytes of RAM per element (and per element in the heap nodes) compared
+  * to BinaryHeap.
+  *
+  * The operations that change the heap take the lock given by the 'Lock' template parameter
+  * (see LockPolicy.h), which is also used by the heap's Arrays.
+  *
+  * Usage example:
+  *
+  * @code
+  * IndexedBinaryHeap<int> heap;
+  * heap.init(16, 16, traits);
+  * IndexedBinaryHeap<int>::handle_t h = heap.insert(100);
+  * heap.insert(50);
+  * heap.decrease_key(h, 10); // 10 is now the root
+  * heap.remove(h);           // and now 50 is
+  * @endcode
+  */
+template <typename T, typename Comparator=MinCompare<T>, unsigned Arity=2, typename Lock=CriticalSectionLock>
+class IndexedBinaryHeap {
+    typedef char arity_must_be_at_least_2[(Arity >= 2) ? 1 : -1];
+    typedef typename LockTraits<Lock>::guard lock_guard;
+
+public:
+    typedef uint32_t handle_t;
+
+    /** Returned by 'insert' when the element can't be inserted */
+    static const handle_t invalid_handle = 0xFFFFFFFF;
+
+    /** Construct a new heap
+      */
+    IndexedBinaryHeap(const Comparator& comparator = Comparator()): _comparator(comparator) {
+    }
+
+    /** Initialize the heap
+      * @param initial_capacity initial capacity of the heap
+      * @param grow_capacity number of elements to add when the heap's capacity is exceeded
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @param alignment alignment of each element in the array
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN) {
+        _elements = 0;
+        _free_handles = _end_of_list;
+        return _nodes.init(initial_capacity, grow_capacity, alloc_traits, alignment) &&
+               _positions.init(initial_capacity, grow_capacity, alloc_traits);
+    }
+
+    /** Inserts an element in the heap
+      * @param e the element to insert
+      * @returns the handle of the new element, or invalid_handle for failure (out of memory)
+      */
+    handle_t insert(const T& e) {
+        lock_guard lock(_lock);
+        handle_t h = _alloc_handle();
+        if (h == invalid_handle)
+            return invalid_handle;
+        if (!_nodes.push_back(heap_node(e, h))) {
+            _free_handle(h);
+            return invalid_handle;
+        }
+        _positions[h] = _elements;
+        _propagate_up(_elements ++);
+        return h;
+    }
+
+    /** Returns a copy of the element in the root of the heap
+      * @returns copy of the root
+      */
+    T get_root() const {
+        if (_elements == 0) {
+            CORE_UTIL_RUNTIME_ERROR("get_root() called on an empty IndexedBinaryHeap");
+        }
+        return _nodes[0].value;
+    }
+
+    /** Returns the handle of the element in the root of the heap
+      * @returns handle of the root, or invalid_handle if the heap is empty
+      */
+    handle_t get_root_handle() const {
+        return _elements == 0 ? invalid_handle : _nodes[0].handle;
+    }
+
+    /** Remove the root of the heap and return a copy of its value
+      * @returns copy of the root
+      */
+    T pop_root() {
+        if (_elements == 0) {
+            CORE_UTIL_RUNTIME_ERROR("pop_root() called on an empty IndexedBinaryHeap");
+        }
+        lock_guard lock(_lock);
+        T temp(CORE_UTIL_MOVE(_nodes[0].value));
+        _remove_at(0);
+        return temp;
+    }
+
+    /** Removes the element at the root of the heap
+      */
+    void remove_root() {
+        lock_guard lock(_lock);
+        if (_elements > 0)
+            _remove_at(0);
+    }
+
+    /** Check if a handle refers to an element in the heap
+      * @param h the handle
+      * @returns true if the handle is valid, false otherwise
+      */
+    bool contains(handle_t h) const {
+        return (h < _positions.get_num_elements()) && !(_positions[h] & _free_bit);
+    }
+
+    /** Returns a copy of an element in the heap
+      * Calling this function with an invalid handle results in a runtime error.
+      * @param h the handle of the element
+      * @returns copy of the element
+      */
+    T get(handle_t h) const {
+        lock_guard lock(_lock);
+        if (!contains(h)) {
+            CORE_UTIL_RUNTIME_ERROR("Invalid handle %u in IndexedBinaryHeap %p\r\n", (unsigned)h, this);
+        }
+        return _nodes[_positions[h]].value;
+    }
+
+    /** Remove an element from the heap in O(log n)
+      * @param h the handle of the element
+      * @returns true if the element was removed, false if the handle is not valid
+      */
+    bool remove(handle_t h) {
+        lock_guard lock(_lock);
+        if (!contains(h))
+            return false;
+        _remove_at(_positions[h]);
+        return true;
+    }
+
+    /** Change the value of an element in the heap in O(log n)
+      * @param h the handle of the element
+      * @param e the new value of the element
+      * @returns true if the element was changed, false if the handle is not valid
+      */
+    bool update_key(handle_t h, const T& e) {
+        lock_guard lock(_lock);
+        if (!contains(h))
+            return false;
+        size_t pos = _positions[h];
+        _nodes[pos].value = e;
+        _restore(pos);
+        return true;
+    }
+
+    /** Move an element towards the root of the heap by changing its value, in O(log n)
+      * The new value must come before (or be equal to) the current value according to the
+      * comparison function (it must be smaller for a min-heap or larger for a max-heap).
+      * @param h the handle of the element
+      * @param e the new value of the element
+      * @returns true if the element was changed, false if the handle is not valid or if
+      *          'e' doesn't come before the current value of the element
+      */
+    bool decrease_key(handle_t h, const T& e) {
+        lock_guard lock(_lock);
+        if (!contains(h))
+            return false;
+        size_t pos = _positions[h];
+        if (!_comparator(e, _nodes[pos].value))
+            return false;
+        _nodes[pos].value = e;
+        _propagate_up(pos);
+        return true;
+    }
+
+    /** Checks if the heap is empty
+      * @returns true if the heap is empty, false otherwise
+      */
+    bool is_empty() const {
+        return _elements == 0;
+    }
+
+    /** Check the heap's consistency by applying the user supplied comparison function to its
+      * nodes and checking the position of each element
+      * @returns true if the heap is consistent, false otherwise
+      */
+    bool is_consistent() const {
+        for (size_t node = 0; node < _elements; node ++) {
+            if (_positions[_nodes[node].handle] != node)
+                return false;
+            if ((node > 0) && !_comparator(_nodes[_parent(node)].value, _nodes[node].value))
+                return false;
+        }
+        return true;
+    }
+
+    /** Returns the number of elements in the heap
+      * @returns number of elements in the heap
+      */
+    size_t get_num_elements() const {
+        return _elements;
+    }
+
+private:
+    struct heap_node {
+        heap_node(const T& v, handle_t h): value(v), handle(h) {
+        }
+
+        T value;
+        handle_t handle;
+    };
+
+    // A free handle has this bit set in '_positions' and the rest of the entry links it
+    // to the next free handle
+    static const uint32_t _free_bit = 0x80000000;
+    static const uint32_t _end_of_list = 0x7FFFFFFF;
+
+    handle_t _alloc_handle() {
+        handle_t h = _free_handles;
+        if (h != _end_of_list) {
+            _free_handles = _positions[h] & ~_free_bit;
+            return h;
+        }
+        h = _positions.get_num_elements();
+        if ((h >= _end_of_list) || !_positions.push_back(0))
+            return invalid_handle;
+        return h;
+    }
+
+    void _free_handle(handle_t h) {
+        _positions[h] = _free_bit | _free_handles;
+        _free_handles = h;
+    }
+
+    size_t _first_child(size_t i) const {
+        return Arity * i + 1;
+    }
+
+    size_t _parent(size_t i) const {
+        return (i - 1) / Arity;
+    }
+
+    // Move a node to a new position and record the position
+    void _place(size_t pos, heap_node& node) {
+        heap_node& dest = _nodes[pos];
+        dest.value = CORE_UTIL_MOVE(node.value);
+        dest.handle = node.handle;
+        _positions[dest.handle] = pos;
+    }
+
+    void _remove_at(size_t pos) {
+        _free_handle(_nodes[pos].handle);
+        if (pos != --_elements) {
+            // Move the last element in place of pos, the last slot is destroyed by 'pop_back()' below
+            _place(pos, _nodes[_elements]);
+        }
+        _nodes.pop_back();
+        if (pos < _elements)
+            _restore(pos);
+    }
+
+    // Move the node at 'pos' up or down until the heap property is satisfied
+    void _restore(size_t pos) {
+        if ((pos > 0) && !_comparator(_nodes[_parent(pos)].value, _nodes[pos].value))
+            _propagate_up(pos);
+        else
+            _propagate_down(pos);
+    }
+
+    // Same algorithms as in BinaryHeap, also keeping track of the position of each element
+    void _propagate_up(size_t node) {
+        if (node == 0)
+            return;
+        heap_node moving(CORE_UTIL_MOVE(_nodes[node]));
+        while (node > 0) {
+            size_t parent = _parent(node);
+            heap_node& parent_ref = _nodes[parent];
+            if (!_comparator(moving.value, parent_ref.value))
+                break;
+            _place(node, parent_ref);
+            node = parent;
+        }
+        _place(node, moving);
+    }
+
+    void _propagate_down(size_t node) {
+        const size_t elements = _elements;
+        heap_node moving(CORE_UTIL_MOVE(_nodes[node]));
+        while (true) {
+            size_t child = _first_child(node), last = child + Arity;
+            if (child >= elements)
+                break;
+            if (last > elements)
+                last = elements;
+            heap_node *child_ptr = &_nodes[child];
+            for (size_t other = child + 1; other < last; other ++) {
+                heap_node& other_ref = _nodes[other];
+                if (!_comparator(child_ptr->value, other_ref.value)) {
+                    child = other;
+                    child_ptr = &other_ref;
+                }
+            }
+            if (_comparator(moving.value, child_ptr->value))
+                break;
+            _place(node, *child_ptr);
+            node = child;
+        }
+        _place(node, moving);
+    }
+
+    Array<heap_node, Lock> _nodes;
+    Array<uint32_t, Lock> _positions;
+    mutable typename LockTraits<Lock>::lock_type _lock; // taken by get() too
+    Comparator _comparator;
+    handle_t _free_handles;
+    volatile size_t _elements;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_INDEXED_BINARY_HEAP_H__
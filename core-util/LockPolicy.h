@@ -0,0 +1,99 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_LOCK_POLICY_H__
+#define __MBED_UTIL_LOCK_POLICY_H__
+
+#include "core-util/CriticalSectionLock.h"
+#include "core-util/SpinLock.h"
+
+namespace mbed {
+namespace util {
+
+/** Lock policies for the containers (Array, BinaryHeap, IndexedBinaryHeap, RadixHeap,
+  * TimingWheel and ExtendablePoolAllocator)
+  *
+  * The lock policy is a template parameter of the container, which keeps an instance of
+  * it and takes it around the operations that change the shared state of the container:
+  *  - CriticalSectionLock (the default) disables interrupts, so the container can be used
+  *    from interrupt handlers too.
+  *  - SpinLock, TicketLock and MCSLock (see SpinLock.h) serialize the threads that run on
+  *    different cores, without disabling interrupts. They must not be used if the container
+  *    is also used from interrupt handlers.
+  *  - NullLock doesn't do anything. It is meant for instances that are only used from a
+  *    single context (or are already protected by a lock of their owner).
+  *
+  * Any class with 'lock()' and 'unlock()' methods (or with a ScopedLock specialization) can
+  * be used as a lock policy.
+  *
+  * Usage example:
+  *
+  * @code
+  * Array<int, NullLock> local_array;           // used only by its owner
+  * BinaryHeap<int, MinCompare<int>, 2, SpinLock> shared_heap;
+  * @endcode
+  */
+class NullLock {
+public:
+    void lock() {
+    }
+
+    void unlock() {
+    }
+};
+
+/** Adapts a lock policy for the containers: 'lock_type' is the member kept in the container
+  * and 'guard' holds the lock until the end of its scope. 'single_context' is true if the
+  * container is only used from one context at a time, so it can skip its atomic operations
+  * too (NullLock). CriticalSectionLock doesn't have any state of its own (it is already a
+  * guard), so it has a specialization.
+  */
+template<typename Lock>
+struct LockTraits {
+    typedef Lock lock_type;
+    typedef ScopedLock<Lock> guard;
+    static const bool single_context = false;
+};
+
+template<>
+struct LockTraits<NullLock> {
+    typedef NullLock lock_type;
+    typedef ScopedLock<NullLock> guard;
+    static const bool single_context = true;
+};
+
+template<>
+struct LockTraits<CriticalSectionLock> {
+    struct lock_type {
+    };
+
+    class guard {
+    public:
+        guard(lock_type&) {
+        }
+
+    private:
+        CriticalSectionLock _lock;
+    };
+
+    static const bool single_context = false;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_LOCK_POLICY_H__
@@ -0,0 +1,258 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_MULTI_QUEUE_H__
+#define __MBED_UTIL_MULTI_QUEUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include "core-util/BinaryHeap.h"
+#include "core-util/PoolAllocator.h"
+#include "core-util/atomic_ops.h"
+#include "core-util/core-util.h"
+#include "ualloc/ualloc.h"
+
+// Alignment of the shards of a MultiQueue in memory (the cache line size), to keep them in
+// different cache lines
+#ifndef MBED_UTIL_MULTI_QUEUE_SHARD_ALIGN
+#define MBED_UTIL_MULTI_QUEUE_SHARD_ALIGN   64
+#endif
+
+namespace mbed {
+namespace util {
+
+/** A concurrent priority queue with relaxed ordering (MultiQueue)
+  *
+  * The queue is made of several shards, each a BinaryHeap protected by its own try-lock.
+  * 'insert' adds the element to a random shard that is not locked. 'pop_root' picks two
+  * random shards and removes the better of their two roots. Different threads (or cores)
+  * mostly work on different shards, so the operations scale with the number of cores, but
+  * the element returned by 'pop_root' is not always the best one in the queue: it is one of
+  * the best elements, with a rank that is on average proportional to the number of shards.
+  *
+  * The locks are never waited for: a locked shard is skipped, so the queue can also be used
+  * from interrupt handlers (the queue has at least 3 shards, so an interrupt handler can
+  * always find shards that are not locked by the code it interrupted). 'insert' tries a
+  * bounded number of shards and returns false if it found all of them locked, 'pop_root'
+  * returns false only if it found all the shards empty (or locked).
+  *
+  * Each shard is aligned to MBED_UTIL_MULTI_QUEUE_SHARD_ALIGN bytes, so that different
+  * shards don't share cache lines.
+  *
+  * Usage example:
+  *
+  * @code
+  * MultiQueue<uint32_t> queue;
+  * queue.init(8, 64, 64, traits); // 8 shards
+  * queue.insert(10);
+  * uint32_t e;
+  * if (queue.pop_root(e)) {
+  *     ...
+  * }
+  * @endcode
+  */
+template <typename T, typename Comparator=MinCompare<T> >
+class MultiQueue {
+public:
+    /** Construct a new queue
+      */
+    MultiQueue(const Comparator& comparator = Comparator()): _storage(NULL), _shards(NULL), _num_shards(0), _comparator(comparator) {
+    }
+
+    ~MultiQueue() {
+        for (size_t i = 0; i < _num_shards; i ++) {
+            _get_shard(i)->~shard();
+        }
+        if (_storage != NULL)
+            mbed_ufree(_storage);
+    }
+
+    /** Initialize the queue
+      * @param num_shards number of shards (at least 3). Use at least twice the number of cores
+      *        that access the queue concurrently.
+      * @param initial_capacity initial capacity of each shard
+      * @param grow_capacity number of elements to add when a shard's capacity is exceeded
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t num_shards, size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits) {
+        if ((_storage != NULL) || (num_shards < 3))
+            return false;
+        _shard_size = PoolAllocator::align_up(sizeof(shard), MBED_UTIL_MULTI_QUEUE_SHARD_ALIGN);
+        // mbed_ualloc doesn't guarantee the alignment, so align the first shard in the block
+        if ((_storage = mbed_ualloc(_shard_size * num_shards + MBED_UTIL_MULTI_QUEUE_SHARD_ALIGN - 1, alloc_traits)) == NULL)
+            return false;
+        _shards = (uint8_t*)(((uintptr_t)_storage + MBED_UTIL_MULTI_QUEUE_SHARD_ALIGN - 1) & ~(uintptr_t)(MBED_UTIL_MULTI_QUEUE_SHARD_ALIGN - 1));
+        _seed = 0;
+        for (; _num_shards < num_shards; _num_shards ++) {
+            shard *s = new(_get_shard(_num_shards)) shard(_comparator);
+            if (!s->heap.init(initial_capacity, grow_capacity, alloc_traits)) {
+                s->~shard();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** Inserts an element in the queue
+      * @param e the element to insert
+      * @returns true for success, false for failure (out of memory, or all the shards that
+      *          were tried are locked)
+      */
+    bool insert(const T& e) {
+        for (size_t attempt = 0; attempt < 2 * _num_shards; attempt ++) {
+            shard *s = _get_shard(_random() % _num_shards);
+            if (!_try_lock(s))
+                continue;
+            bool res = s->heap.insert(e);
+            _unlock(s);
+            return res;
+        }
+        return false;
+    }
+
+    /** Remove one of the best elements in the queue (see the class description)
+      * @param e receives the removed element
+      * @returns true if an element was removed, false if the queue was found empty
+      */
+    bool pop_root(T& e) {
+        for (size_t attempt = 0; attempt < 2 * _num_shards; attempt ++) {
+            uint32_t r = _random();
+            shard *a = _get_shard(r % _num_shards), *b = _get_shard((r >> 16) % _num_shards);
+            if (!_try_lock(a))
+                continue;
+            if ((a == b) || !_try_lock(b))
+                b = NULL;
+            shard *best = _better(a, b);
+            if (best != NULL)
+                e = best->heap.pop_root();
+            _unlock(a);
+            if (b != NULL)
+                _unlock(b);
+            if (best != NULL)
+                return true;
+            // Both shards are empty, so the whole queue is probably (almost) empty
+            break;
+        }
+        // Check all the shards, starting from a random one
+        size_t start = _random() % _num_shards;
+        for (size_t i = 0; i < _num_shards; i ++) {
+            shard *s = _get_shard((start + i) % _num_shards);
+            if (!_try_lock(s))
+                continue;
+            bool found = !s->heap.is_empty();
+            if (found)
+                e = s->heap.pop_root();
+            _unlock(s);
+            if (found)
+                return true;
+        }
+        return false;
+    }
+
+    /** Returns the number of elements in the queue. The result is approximate if the queue
+      * is modified concurrently.
+      * @returns number of elements in the queue
+      */
+    size_t get_num_elements() const {
+        size_t elements = 0;
+        for (size_t i = 0; i < _num_shards; i ++) {
+            elements += _get_shard(i)->heap.get_num_elements();
+        }
+        return elements;
+    }
+
+    /** Checks if the queue is empty. The result is approximate if the queue is modified
+      * concurrently.
+      * @returns true if the queue is empty, false otherwise
+      */
+    bool is_empty() const {
+        return get_num_elements() == 0;
+    }
+
+    /** Returns the number of shards in the queue
+      * @returns number of shards
+      */
+    size_t get_num_shards() const {
+        return _num_shards;
+    }
+
+private:
+    struct shard {
+        shard(const Comparator& comparator): lock(0), heap(comparator) {
+        }
+
+        uint32_t lock;
+        BinaryHeap<T, Comparator, 2, NullLock> heap; // protected by 'lock'
+    };
+
+    shard *_get_shard(size_t i) const {
+        return (shard*)(_shards + i * _shard_size);
+    }
+
+    bool _try_lock(shard *s) {
+        uint32_t unlocked = 0;
+        return atomic_cas(&s->lock, &unlocked, 1u);
+    }
+
+    void _unlock(shard *s) {
+        atomic_decr(&s->lock, 1u);
+    }
+
+    // Return the shard with the best root among 'a' and 'b' (which can be NULL), or NULL
+    // if both are empty
+    shard *_better(shard *a, shard *b) {
+        if ((b == NULL) || b->heap.is_empty())
+            return a->heap.is_empty() ? NULL : a;
+        if (a->heap.is_empty())
+            return b;
+        return _comparator(a->heap.get_root(), b->heap.get_root()) ? a : b;
+    }
+
+    // A xorshift generator. With thread-local storage, each thread has its own state.
+    // Otherwise the state is shared and updated atomically.
+    uint32_t _random() {
+#if defined(TARGET_LIKE_POSIX) && (defined(__GNUC__) || defined(__clang__))
+        static __thread uint32_t state;
+        if (state == 0)
+            state = (uint32_t)(uintptr_t)&state | 1;
+        uint32_t x = state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return state = x;
+#else
+        uint32_t x = atomic_incr(&_seed, 0x9E3779B9u);
+        x ^= x >> 16;
+        x *= 0x85EBCA6Bu;
+        x ^= x >> 13;
+        return x;
+#endif
+    }
+
+    void *_storage;
+    uint8_t *_shards;
+    size_t _num_shards, _shard_size;
+    Comparator _comparator;
+    uint32_t _seed;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_MULTI_QUEUE_H__
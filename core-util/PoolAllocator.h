@@ -25,6 +25,17 @@
 // aligned at 4 bytes
 // [TODO] where should the system allocator alignment be defined?
 #define MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN       4
+
+// Use a 64-bit free list head (32-bit element indexes and tags) on 64-bit targets, and a
+// 32-bit head (16-bit indexes and tags) on 32-bit targets, where a 64-bit compare-and-swap
+// would need a critical section
+#ifndef MBED_UTIL_POOL_ALLOC_WIDE_HEAD
+#if defined(__LP64__) || defined(_WIN64)
+#define MBED_UTIL_POOL_ALLOC_WIDE_HEAD          1
+#else
+#define MBED_UTIL_POOL_ALLOC_WIDE_HEAD          0
+#endif
+#endif
 // [TODO] currently, the requested alignment (in the PoolAllocator constructor) must be
 // less than or equal to MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN, which effectively limits it to
 // 4 bytes for now
@@ -35,6 +46,19 @@ namespace util {
 /** A simple pool allocator class. It can allocate one elements oe 'element_size' bytes at a time.
   * alloc() and free() operations are synchronized, they can be used safely from both user
   * and interrupt context.
+  *
+  * The free elements are kept in a lock-free list. The elements are linked using their
+  * indexes in the pool and the head of the list packs the index of the first free element
+  * together with a modification tag in a single word, so that it can be updated with a
+  * single native compare-and-swap. The tag changes on every update of the head, which
+  * protects the list against the ABA problem. On 64-bit targets the head is a 64-bit word
+  * with a 32-bit index and a 32-bit tag. On 32-bit targets it is a 32-bit word with a 16-bit
+  * index and a 16-bit tag, so a pool holds at most 65535 elements there. Use
+  * get_max_elements() to query the limit of the current target.
+  *
+  * The pool is initialized lazily: elements that were never allocated are handed out from a
+  * bump pointer, and only the elements returned with free() are linked in the free list. This
+  * makes the construction of the pool O(1) and doesn't touch the pool memory until it is used.
   */
 class PoolAllocator {
 public:
@@ -44,6 +68,8 @@ public:
       * @param element_size size of each pool element in bytes (this might be rounded up
                to satisfy the 'alignment' argument)
       * @param alignment allocation alignment in bytes (must be a power of 2, at least 4)
+      * 'elements' must not be larger than get_max_elements(). This is asserted; if asserts
+      * are disabled, a larger pool is created empty (alloc() always returns NULL).
       */
     PoolAllocator(void *start, size_t elements, size_t element_size, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN);
 
@@ -62,6 +88,22 @@ public:
       */
     void free(void* p);
 
+    /** Allocate up to 'n' elements from the pool. The elements are detached from the pool's
+      * free list with a single atomic operation.
+      * @param blocks array that receives the addresses of the allocated elements
+      * @param n number of elements to allocate
+      * @returns the number of allocated elements, which is less than 'n' if the pool doesn't
+      *          have enough free elements
+      */
+    size_t alloc_n(void **blocks, size_t n);
+
+    /** Free 'n' previously allocated elements. The elements are returned to the pool's free
+      * list with a single atomic operation. Elements not owned by this pool are ignored.
+      * @param blocks array with the addresses of the elements
+      * @param n number of elements in 'blocks'
+      */
+    void free_n(void **blocks, size_t n);
+
     /** Returns a pool size suitable to hold the required number of elements
       * @param elements the size of pool in elements (each of element_size bytes)
       * @param element_size size of each pool element in bytes (this might be rounded up
@@ -71,6 +113,12 @@ public:
       */
     static size_t get_pool_size(size_t elements, size_t element_size, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN);
 
+    /** Returns the maximum number of elements in a pool, which is limited by the size
+      * of the element indexes in the free list head
+      * @returns 65535 on 32-bit targets, 4294967295 on 64-bit targets
+      */
+    static size_t get_max_elements();
+
     /** Check if this pool owns a pointer
       * @param p the pointer to check
       * @returns true if the pointer is inside this pool, false otherwise
@@ -90,9 +138,92 @@ public:
     void* get_start_address() const;
 
 private:
+    friend class PoolAllocatorMagazine;
+
     void _init();
 
-    void *_start, *_free_block, *_end;
+    /** Detach a chain of up to 'n' free elements from the pool with a single atomic operation
+      * @param n the maximum number of elements to detach
+      * @param count will be set to the number of elements in the chain
+      * @returns the first element of the chain (the chain ends with an element whose
+      *          _get_next() is NULL), or NULL if the pool is empty
+      */
+    void *_alloc_chain(size_t n, size_t *count);
+
+    /** Return a chain of elements to the pool with a single atomic operation
+      * @param first the first element in the chain
+      * @param last the last element in the chain (its link will be overwritten)
+      */
+    void _free_chain(void *first, void *last);
+
+    /** Allocate up to 'n' contiguous elements that were never used before
+      * @param n the maximum number of elements to allocate
+      * @param count will be set to the number of allocated elements
+      * @returns the first allocated element or NULL if the pool was fully used
+      */
+    void *_alloc_fresh(size_t n, size_t *count);
+
+    // Links between free elements are element indexes in the pool
+    typedef uint32_t link_t;
+    static const link_t _null_link = 0xFFFFFFFF;
+
+#if MBED_UTIL_POOL_ALLOC_WIDE_HEAD
+    typedef uint64_t head_t;
+    static const unsigned _head_index_bits = 32;
+#else
+    typedef uint32_t head_t;
+    static const unsigned _head_index_bits = 16;
+#endif
+    // Index field of a head that doesn't point to any element
+    static const head_t _head_null_index = ((head_t)1 << _head_index_bits) - 1;
+
+    /** Packs an element index and a tag in a free list head
+      * @param link the index of the first free element or _null_link
+      * @param tag the modification tag (truncated to the size of the tag field)
+      * @returns the free list head
+      */
+    static head_t _make_head(link_t link, head_t tag) {
+        return (tag << _head_index_bits) | (link == _null_link ? _head_null_index : (head_t)link);
+    }
+
+    static link_t _head_link(head_t head) {
+        head_t index = head & _head_null_index;
+        return index == _head_null_index ? _null_link : (link_t)index;
+    }
+
+    static head_t _head_tag(head_t head) {
+        return head >> _head_index_bits;
+    }
+
+    void *_get_element(link_t link) const {
+        return (uint8_t *)_start + link * _element_size;
+    }
+
+    /** Returns the element that follows a free element in its chain
+      * @param blk the free element
+      * @returns the next element or NULL if 'blk' is the last element in the chain
+      */
+    void *_get_next(void *blk) const {
+        link_t next = *((link_t *)blk);
+        return next == _null_link ? NULL : _get_element(next);
+    }
+
+    /** Links a free element to the next element in its chain
+      * @param blk the free element
+      * @param next the next element or NULL to mark 'blk' as the last element in the chain
+      */
+    void _set_next(void *blk, void *next) {
+        *((link_t *)blk) = next == NULL ? _null_link : (link_t)(((uint8_t *)next - (uint8_t *)_start) / _element_size);
+    }
+
+    void *_start, *_end;
+    // Head of the free list: the index of the first free element in the low bits and the
+    // ABA tag in the high bits
+    head_t _free_head;
+    // Number of elements in the pool
+    link_t _elements;
+    // Offset of the first element that was never allocated
+    link_t _bump;
     size_t _element_size;
 };
 
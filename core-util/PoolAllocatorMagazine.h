@@ -0,0 +1,102 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_POOL_ALLOCATOR_MAGAZINE_H__
+#define __MBED_UTIL_POOL_ALLOCATOR_MAGAZINE_H__
+
+#include <stddef.h>
+#include "core-util/PoolAllocator.h"
+
+#ifndef MBED_UTIL_POOL_MAGAZINE_DEFAULT_CAPACITY
+#define MBED_UTIL_POOL_MAGAZINE_DEFAULT_CAPACITY    16
+#endif
+
+namespace mbed {
+namespace util {
+
+/** A per-thread cache ("magazine") of free elements in front of a shared PoolAllocator.
+  *
+  * The magazine keeps a small stack of free elements that belong to the pool. alloc() and
+  * free() only touch this stack, so they don't use any atomic operations and don't contend
+  * with other threads on the pool's free list. When the magazine is empty, it is refilled
+  * with a batch of elements detached from the pool with a single atomic operation; when it
+  * is full, a batch of elements is returned to the pool in the same way.
+  *
+  * A magazine is NOT synchronized: each thread (or execution context) must use its own
+  * instance. Elements can be freed through any magazine attached to the same pool, or
+  * directly through the pool. The cached elements are returned to the pool when the
+  * magazine is destroyed.
+  *
+  * Usage example:
+  *
+  * @code
+  * PoolAllocator pool(start, elements, element_size);
+  *
+  * void worker_thread() {
+  *     PoolAllocatorMagazine magazine(pool);
+  *     void *p = magazine.alloc();
+  *     ...
+  *     magazine.free(p);
+  * }
+  * @endcode
+  */
+class PoolAllocatorMagazine {
+public:
+    /** Create a new magazine
+      * @param pool the pool that provides the elements
+      * @param capacity the maximum number of elements cached by this magazine. Refills and
+      *        flushes move half of this number of elements between the magazine and the pool.
+      */
+    PoolAllocatorMagazine(PoolAllocator& pool, size_t capacity = MBED_UTIL_POOL_MAGAZINE_DEFAULT_CAPACITY);
+
+    /** Destructor. It returns all the cached elements to the pool
+      */
+    ~PoolAllocatorMagazine();
+
+    /** Allocate a new element, refilling the magazine from the pool if needed
+      * @returns the address of the new element or NULL for error
+      */
+    void *alloc();
+
+    /** Free a previously allocated element, flushing part of the magazine to the pool if needed
+      * @param p pointer to element
+      */
+    void free(void *p);
+
+    /** Return all the cached elements to the pool
+      */
+    void flush();
+
+    /** Returns the number of free elements currently cached in the magazine
+      * @returns number of cached elements
+      */
+    size_t get_num_cached() const;
+
+private:
+    PoolAllocatorMagazine(const PoolAllocatorMagazine&);
+    PoolAllocatorMagazine& operator =(const PoolAllocatorMagazine&);
+
+    PoolAllocator& _pool;
+    void *_top;
+    size_t _count, _capacity, _batch;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_POOL_ALLOCATOR_MAGAZINE_H__
+
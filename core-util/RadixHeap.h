@@ -0,0 +1,278 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_RADIX_HEAP_H__
+#define __MBED_UTIL_RADIX_HEAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/CriticalSectionLock.h"
+#include "core-util/Array.h"
+#include "core-util/LockPolicy.h"
+#include "core-util/core-util.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+/** A reentrant radix heap: a min-heap for unsigned integer keys, where the keys of the
+  * inserted elements are never smaller than the key of the last element removed from the
+  * root (monotone keys, like timestamps that only move forward).
+  *
+  * The elements are kept in 'number of bits in Key + 1' buckets, each stored in an Array.
+  * Bucket 0 holds the elements with the same key as the last removed root, and bucket i > 0
+  * holds the elements whose key differs from it first in bit i - 1. When bucket 0 is empty,
+  * the minimum of the first non-empty bucket becomes the new reference key and that bucket
+  * is redistributed to the lower buckets. Each element can only move to lower buckets, so
+  * the operations take O(log C) amortized time (where C is the range of the keys) and the
+  * minimum is found with linear scans of contiguous memory instead of comparisons along a
+  * tree.
+  *
+  * The interface follows BinaryHeap, with separate keys and values. The bucket Arrays are
+  * initialized the first time they're used, each with 'initial_capacity' elements. They
+  * are only accessed with the heap's lock held (given by the 'Lock' template parameter, see
+  * LockPolicy.h), so they use the NullLock policy.
+  *
+  * Usage example:
+  *
+  * @code
+  * RadixHeap<uint32_t, Event> timers;
+  * timers.init(8, 8, traits);
+  * timers.insert(now + 100, event);
+  * ...
+  * uint32_t when;
+  * Event e = timers.pop_root(&when);
+  * @endcode
+  */
+template <typename Key, typename Value, typename Lock=CriticalSectionLock>
+class RadixHeap {
+    typedef typename LockTraits<Lock>::guard lock_guard;
+
+public:
+    /** Construct a new radix heap
+      */
+    RadixHeap() {
+    }
+
+    /** Initialize the heap
+      * @param initial_capacity initial capacity of each bucket of the heap
+      * @param grow_capacity number of elements to add when a bucket's capacity is exceeded
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @param alignment alignment of each element in the buckets
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t initial_capacity, size_t grow_capacity, UAllocTraits_t alloc_traits, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN) {
+        if (initial_capacity == 0)
+            return false;
+        _initial_capacity = initial_capacity;
+        _grow_capacity = grow_capacity;
+        _alloc_traits = alloc_traits;
+        _alignment = alignment;
+        _last = 0;
+        _elements = 0;
+        return true;
+    }
+
+    /** Inserts an element in the heap
+      * @param key the key of the element. It must not be smaller than the key of the last
+      *        element removed from the root of the heap.
+      * @param value the value of the element
+      * @returns true for success, false for failure (out of memory or key too small)
+      */
+    bool insert(const Key& key, const Value& value) {
+        lock_guard lock(_lock);
+        if (key < _last)
+            return false;
+        Array<entry, NullLock>& bucket = _buckets[_bucket_index(key)];
+        if ((bucket.get_num_zones() == 0) && !bucket.init(_initial_capacity, _grow_capacity, _alloc_traits, _alignment))
+            return false;
+        if (!bucket.push_back(entry(key, value)))
+            return false;
+        _elements ++;
+        return true;
+    }
+
+    /** Returns a copy of the value in the root of the heap (the value with the smallest key)
+      * @param key if not NULL, receives the key of the root
+      * @returns copy of the value
+      */
+    Value get_root(Key *key = NULL) {
+        lock_guard lock(_lock);
+        unsigned bucket_idx, pos;
+        const entry& root = _root(&bucket_idx, &pos);
+        if (key != NULL)
+            *key = root.key;
+        return root.value;
+    }
+
+    /** Remove the root of the heap and return a copy of its value
+      * @param key if not NULL, receives the key of the root
+      * @returns copy of the value
+      */
+    Value pop_root(Key *key = NULL) {
+        lock_guard lock(_lock);
+        unsigned bucket_idx, pos;
+        entry& root = _root(&bucket_idx, &pos);
+        if (key != NULL)
+            *key = root.key;
+        Value temp(CORE_UTIL_MOVE(root.value));
+        _remove(bucket_idx, pos);
+        return temp;
+    }
+
+    /** Removes the element at the root of the heap
+      */
+    void remove_root() {
+        lock_guard lock(_lock);
+        if (_elements == 0)
+            return;
+        unsigned bucket_idx, pos;
+        _root(&bucket_idx, &pos);
+        _remove(bucket_idx, pos);
+    }
+
+    /** Checks if the heap is empty
+      * @returns true if the heap is empty, false otherwise
+      */
+    bool is_empty() const {
+        return _elements == 0;
+    }
+
+    /** Returns the number of elements in the heap
+      * @returns number of elements in the heap
+      */
+    size_t get_num_elements() const {
+        return _elements;
+    }
+
+    /** Returns the smallest key that can be inserted (the key of the last removed root)
+      * @returns smallest key
+      */
+    Key get_last_key() const {
+        return _last;
+    }
+
+private:
+    struct entry {
+        entry(const Key& k, const Value& v): key(k), value(v) {
+        }
+
+        Key key;
+        Value value;
+    };
+
+    static const unsigned _num_buckets = sizeof(Key) * 8 + 1;
+
+    static unsigned _msb_index(Key n) {
+#if defined(__GNUC__) || defined(__clang__)
+        if (sizeof(Key) <= sizeof(unsigned))
+            return sizeof(unsigned) * 8 - 1 - __builtin_clz((unsigned)n);
+        return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll((unsigned long long)n);
+#else
+        unsigned idx = 0;
+        while (n >>= 1) {
+            idx ++;
+        }
+        return idx;
+#endif
+    }
+
+    unsigned _bucket_index(const Key& key) const {
+        return key == _last ? 0 : _msb_index(key ^ _last) + 1;
+    }
+
+    // Find the root of the heap. Normally the root is moved to the end of bucket 0, but if
+    // there's not enough memory to redistribute a bucket, it is left in its bucket (and
+    // removing it from there doesn't change the buckets of the other elements).
+    entry& _root(unsigned *bucket_idx, unsigned *pos) {
+        if (_elements == 0) {
+            CORE_UTIL_RUNTIME_ERROR("Attempt to get the root of an empty RadixHeap %p\r\n", this);
+        }
+        if (_buckets[0].get_num_elements() == 0) {
+            unsigned i = 1;
+            while (_buckets[i].get_num_elements() == 0) {
+                i ++;
+            }
+            // The smallest key in the first non-empty bucket becomes the new reference key,
+            // then all the elements of the bucket move to lower buckets
+            Array<entry, NullLock>& bucket = _buckets[i];
+            unsigned n = bucket.get_num_elements(), min_pos = 0;
+            for (unsigned j = 1; j < n; j ++) {
+                if (bucket[j].key < bucket[min_pos].key)
+                    min_pos = j;
+            }
+            Key old_last = _last;
+            _last = bucket[min_pos].key;
+            if (!_reserve_for(bucket)) {
+                // Keep the old reference key, so that the buckets stay consistent
+                _last = old_last;
+                *bucket_idx = i;
+                *pos = min_pos;
+                return bucket[min_pos];
+            }
+            for (unsigned j = 0; j < n; j ++) {
+                entry& e = bucket[j];
+                _buckets[_bucket_index(e.key)].push_back(CORE_UTIL_MOVE(e));
+            }
+            bucket.clear();
+        }
+        *bucket_idx = 0;
+        *pos = _buckets[0].get_num_elements() - 1;
+        return _buckets[0][*pos];
+    }
+
+    // Make sure that the lower buckets have space for the elements of 'bucket'
+    bool _reserve_for(Array<entry, NullLock>& bucket) {
+        unsigned counts[_num_buckets] = {0};
+        for (unsigned j = 0; j < bucket.get_num_elements(); j ++) {
+            counts[_bucket_index(bucket[j].key)] ++;
+        }
+        for (unsigned i = 0; i < _num_buckets; i ++) {
+            if (counts[i] == 0)
+                continue;
+            Array<entry, NullLock>& dest = _buckets[i];
+            if ((dest.get_num_zones() == 0) && !dest.init(_initial_capacity, _grow_capacity, _alloc_traits, _alignment))
+                return false;
+            if (!dest.reserve(dest.get_num_elements() + counts[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // Remove the element at position 'pos' in a bucket
+    void _remove(unsigned bucket_idx, unsigned pos) {
+        Array<entry, NullLock>& bucket = _buckets[bucket_idx];
+        unsigned last = bucket.get_num_elements() - 1;
+        if (pos != last)
+            bucket[pos] = CORE_UTIL_MOVE(bucket[last]);
+        bucket.pop_back();
+        _elements --;
+    }
+
+    Array<entry, NullLock> _buckets[_num_buckets];
+    size_t _initial_capacity, _grow_capacity;
+    UAllocTraits_t _alloc_traits;
+    unsigned _alignment;
+    Key _last;
+    volatile size_t _elements;
+    typename LockTraits<Lock>::lock_type _lock;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_RADIX_HEAP_H__
@@ -0,0 +1,319 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_SPIN_LOCK_H__
+#define __MBED_UTIL_SPIN_LOCK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/Atomic.h"
+#ifdef TARGET_LIKE_POSIX
+#include <sched.h>
+#endif
+
+// Maximum number of busy-wait iterations between two checks of a lock
+#ifndef MBED_UTIL_SPIN_LOCK_MAX_BACKOFF
+#define MBED_UTIL_SPIN_LOCK_MAX_BACKOFF     1024
+#endif
+
+// Busy-wait iterations per waiter ahead in a TicketLock
+#ifndef MBED_UTIL_TICKET_LOCK_BACKOFF
+#define MBED_UTIL_TICKET_LOCK_BACKOFF       16
+#endif
+
+namespace mbed {
+namespace util {
+
+/** Exponential backoff for busy-wait loops
+  *
+  * Each call to 'pause' waits twice as long as the previous one, up to a maximum, so the
+  * contexts that wait for a lock check it less and less often and leave the interconnect
+  * to the owner of the lock. On POSIX targets, a waiter that reached the maximum delay
+  * also yields the CPU, in case the owner of the lock is waiting for it. It is used by
+  * SpinLock; the FIFO locks (TicketLock, MCSLock) don't back off exponentially, since their
+  * next owner is already chosen and delaying it only delays everyone behind it.
+  */
+class Backoff {
+public:
+    /** Create a new backoff sequence
+      * @param max_delay maximum number of busy-wait iterations in 'pause'
+      */
+    Backoff(uint32_t max_delay = MBED_UTIL_SPIN_LOCK_MAX_BACKOFF): _delay(1), _max_delay(max_delay) {
+    }
+
+    /** Busy-wait, then double the next delay
+      */
+    void pause() {
+        delay(_delay);
+        if (_delay < _max_delay) {
+            _delay <<= 1;
+        } else {
+#ifdef TARGET_LIKE_POSIX
+            sched_yield();
+#endif
+        }
+    }
+
+    /** Busy-wait for a number of iterations
+      * @param iterations number of iterations
+      */
+    static void delay(uint32_t iterations) {
+        for (uint32_t i = 0; i < iterations; i ++) {
+            relax();
+        }
+    }
+
+    /** Tell the CPU that this is a busy-wait loop
+      */
+    static void relax() {
+#if defined(__CC_ARM)
+        __yield();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+        __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__arm__)
+        __asm__ volatile("yield" ::: "memory");
+#elif defined(__GNUC__) || defined(__clang__)
+        __asm__ volatile("" ::: "memory");
+#endif
+    }
+
+private:
+    uint32_t _delay;
+    uint32_t _max_delay;
+};
+
+/** RAII object that holds a lock until the end of its scope, in the style of
+  * CriticalSectionLock
+  * Usage:
+  * @code
+  *
+  * SpinLock lock;
+  *
+  * void f() {
+  *     ScopedLock<SpinLock> guard(lock);
+  *     // Code in this block runs with 'lock' held
+  * }
+  * @endcode
+  */
+template<typename Lock>
+class ScopedLock {
+public:
+    ScopedLock(Lock& lock): _lock(lock) {
+        _lock.lock();
+    }
+
+    ~ScopedLock() {
+        _lock.unlock();
+    }
+
+private:
+    Lock& _lock;
+};
+
+/** A test-and-set spin lock
+  *
+  * The lock is taken with a compare-and-swap. While it is held by someone else, the waiting
+  * context only reads the lock word, so it doesn't keep stealing the cache line from the
+  * owner, and it waits longer between reads as the wait gets longer (see Backoff). The lock
+  * is not fair: a context can take it repeatedly while others wait.
+  *
+  * Spin locks serialize threads that run on different cores. They must not protect data
+  * that is shared with interrupt handlers: a handler that waits for a lock held by the code
+  * it interrupted never returns (use CriticalSectionLock for that).
+  */
+class SpinLock {
+public:
+    /** Create a new (unlocked) spin lock
+      */
+    SpinLock(): _locked(0) {
+    }
+
+    /** Take the lock, waiting until it is available
+      */
+    void lock() {
+        Backoff backoff;
+        while (!try_lock()) {
+            do {
+                backoff.pause();
+            } while (_locked.load(memory_order_relaxed) != 0);
+        }
+    }
+
+    /** Take the lock if it is available
+      * @returns true if the lock was taken, false otherwise
+      */
+    bool try_lock() {
+        uint32_t unlocked = 0;
+        return _locked.compare_exchange_strong(unlocked, 1, memory_order_acquire);
+    }
+
+    /** Release the lock
+      */
+    void unlock() {
+        _locked.store(0, memory_order_release);
+    }
+
+private:
+    Atomic<uint32_t> _locked;
+};
+
+/** A ticket lock: a fair spin lock
+  *
+  * Each context that wants the lock takes the next ticket, then waits until that ticket is
+  * served, so the lock is granted in the order in which it was requested. A waiter waits in
+  * proportion to the number of waiters ahead of it (up to MBED_UTIL_SPIN_LOCK_MAX_BACKOFF
+  * iterations) before checking the lock again. Like SpinLock, it must not protect data that
+  * is shared with interrupt handlers.
+  *
+  * The lock is handed to the waiters in a fixed order, so if the next waiter is not running,
+  * nobody can take the lock until it runs again. The FIFO locks (TicketLock and MCSLock)
+  * must not be used when the threads that use them can outnumber the cores; use SpinLock
+  * in that case.
+  */
+class TicketLock {
+public:
+    /** Create a new (unlocked) ticket lock
+      */
+    TicketLock(): _next(0), _serving(0) {
+    }
+
+    /** Take the lock, waiting until all the earlier requests are served
+      */
+    void lock() {
+        uint32_t ticket = _next.fetch_add(1, memory_order_relaxed);
+        uint32_t serving;
+        while ((serving = _serving.load(memory_order_acquire)) != ticket) {
+            uint32_t delay = (ticket - serving) * MBED_UTIL_TICKET_LOCK_BACKOFF;
+            Backoff::delay(delay < MBED_UTIL_SPIN_LOCK_MAX_BACKOFF ? delay : MBED_UTIL_SPIN_LOCK_MAX_BACKOFF);
+        }
+    }
+
+    /** Take the lock if nobody holds it or waits for it
+      * @returns true if the lock was taken, false otherwise
+      */
+    bool try_lock() {
+        uint32_t ticket = _serving.load(memory_order_relaxed);
+        return _next.compare_exchange_strong(ticket, ticket + 1, memory_order_acquire, memory_order_relaxed);
+    }
+
+    /** Release the lock, serving the next ticket
+      */
+    void unlock() {
+        // Only the owner of the lock changes '_serving'
+        _serving.store(_serving.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+private:
+    Atomic<uint32_t> _next;
+    Atomic<uint32_t> _serving;
+};
+
+/** An MCS queue lock (Mellor-Crummey and Scott)
+  *
+  * The contexts that wait for the lock form a queue, and each one spins on a flag in its
+  * own queue node instead of on the lock word, so a release only touches the cache line of
+  * the next waiter. Like TicketLock, the lock is granted in FIFO order. The queue node is
+  * kept by the caller (usually on its stack) while it holds or waits for the lock;
+  * ScopedLock<MCSLock> does that automatically.
+  *
+  * Like SpinLock, it must not protect data that is shared with interrupt handlers. Like
+  * TicketLock, it must not be used when the threads that use it can outnumber the cores.
+  */
+class MCSLock {
+public:
+    /** Queue node, one per context that holds or waits for the lock
+      */
+    struct node {
+        Atomic<node*> next;
+        Atomic<uint32_t> locked;
+    };
+
+    /** Create a new (unlocked) MCS lock
+      */
+    MCSLock(): _tail(NULL) {
+    }
+
+    /** Take the lock, waiting for the contexts that asked for it before
+      * @param n the queue node of the caller, which must stay valid until 'unlock'
+      */
+    void lock(node& n) {
+        n.next.store(NULL, memory_order_relaxed);
+        n.locked.store(1, memory_order_relaxed);
+        node *prev = _tail.exchange(&n, memory_order_acq_rel);
+        if (prev != NULL) {
+            prev->next.store(&n, memory_order_release);
+            // The flag is in the caller's own node, so spinning on it is cheap
+            while (n.locked.load(memory_order_acquire)) {
+                Backoff::relax();
+            }
+        }
+    }
+
+    /** Take the lock if nobody holds it
+      * @param n the queue node of the caller, which must stay valid until 'unlock'
+      * @returns true if the lock was taken, false otherwise
+      */
+    bool try_lock(node& n) {
+        n.next.store(NULL, memory_order_relaxed);
+        n.locked.store(0, memory_order_relaxed);
+        node *empty = NULL;
+        return _tail.compare_exchange_strong(empty, &n, memory_order_acquire, memory_order_relaxed);
+    }
+
+    /** Release the lock, passing it to the next waiter (if any)
+      * @param n the queue node given to 'lock'
+      */
+    void unlock(node& n) {
+        node *next = n.next.load(memory_order_acquire);
+        if (next == NULL) {
+            node *self = &n;
+            if (_tail.compare_exchange_strong(self, NULL, memory_order_release, memory_order_relaxed))
+                return;
+            // A new waiter is linking itself after this node
+            while ((next = n.next.load(memory_order_acquire)) == NULL) {
+                Backoff::relax();
+            }
+        }
+        next->locked.store(0, memory_order_release);
+    }
+
+private:
+    Atomic<node*> _tail;
+};
+
+/** ScopedLock for MCSLock, which keeps the queue node
+  */
+template<>
+class ScopedLock<MCSLock> {
+public:
+    ScopedLock(MCSLock& lock): _lock(lock) {
+        _lock.lock(_node);
+    }
+
+    ~ScopedLock() {
+        _lock.unlock(_node);
+    }
+
+private:
+    MCSLock& _lock;
+    MCSLock::node _node;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_SPIN_LOCK_H__
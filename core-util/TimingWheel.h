@@ -0,0 +1,367 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MBED_UTIL_TIMING_WHEEL_H__
+#define __MBED_UTIL_TIMING_WHEEL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include "core-util/CriticalSectionLock.h"
+#include "core-util/LockPolicy.h"
+#include "core-util/Event.h"
+#include "core-util/PoolAllocator.h"
+#include "core-util/core-util.h"
+#include "ualloc/ualloc.h"
+
+namespace mbed {
+namespace util {
+
+/** A reentrant hierarchical timing wheel: a timer queue with O(1) schedule and cancel
+  * operations and O(1) amortized expiration.
+  *
+  * Time is measured in ticks (uint32_t, wrapping around). Each timer holds a copy of
+  * a payload of type T (an Event by default). The wheel has 6 levels of 64 slots each:
+  * a timer that expires less than 64 ticks in the future is stored in level 0, in the
+  * slot of its expiration tick. Timers further in the future are stored in the higher
+  * levels, with each level covering 64 times the range of the level below. When the
+  * time reaches the start of a higher level slot, its timers are moved (cascaded) to
+  * the lower levels. Any delay that fits in 32 bits can be scheduled. Empty slots are
+  * skipped using a bitmap of the occupied slots in each level, so advancing the time by
+  * a large amount costs the same as advancing it to the next occupied slot.
+  *
+  * The timers are allocated from a PoolAllocator, so the maximum number of pending timers
+  * is given to 'init'. A timer is identified by the handle returned by 'schedule', which
+  * stays valid until the timer is cancelled or its payload is returned by 'pop_expired'.
+  * The timer lists are protected by the lock given by the 'Lock' template parameter (see
+  * LockPolicy.h).
+  *
+  * Usage example:
+  *
+  * @code
+  * TimingWheel<> wheel;
+  * wheel.init(128, traits);
+  * TimingWheel<>::handle_t h = wheel.schedule(100, fp.bind());
+  * ...
+  * wheel.advance(current_ticks);
+  * Event e;
+  * while (wheel.pop_expired(e))
+  *     e.call();
+  * @endcode
+  */
+template <typename T=Event, typename Lock=CriticalSectionLock>
+class TimingWheel {
+    struct timer_node;
+    typedef typename LockTraits<Lock>::guard lock_guard;
+
+public:
+    typedef timer_node* handle_t;
+
+    /** Create a new timing wheel
+      */
+    TimingWheel(): _pool(NULL) {
+    }
+
+    ~TimingWheel() {
+        if (NULL == _pool)
+            return;
+        // Destroy the payloads of all the remaining timers
+        for (unsigned i = 0; i < _num_levels * _num_slots; i ++) {
+            _destroy_list(_slots[i]);
+        }
+        _destroy_list(_expired_head);
+        void *storage = _pool_storage;
+        _pool->~PoolAllocator();
+        mbed_ufree(storage);
+    }
+
+    /** Initialize the timing wheel
+      * @param max_timers maximum number of pending (scheduled or expired) timers
+      * @param alloc_traits allocator traits (for mbed_ualloc)
+      * @param now the current time (in ticks)
+      * @returns true if the initialization succeeded, false otherwise
+      */
+    bool init(size_t max_timers, UAllocTraits_t alloc_traits, uint32_t now = 0) {
+        if (_pool != NULL)
+            return false; // prevent repeated initialization
+        // Layout: pool storage area | PoolAllocator instance (8-byte aligned)
+        size_t pool_storage_size = PoolAllocator::get_pool_size(max_timers, sizeof(timer_node));
+        pool_storage_size = PoolAllocator::align_up(pool_storage_size, sizeof(uint64_t));
+        _pool_storage = mbed_ualloc(pool_storage_size + sizeof(PoolAllocator), alloc_traits);
+        if (NULL == _pool_storage)
+            return false;
+        _pool = new((char*)_pool_storage + pool_storage_size) PoolAllocator(_pool_storage, max_timers, sizeof(timer_node));
+        for (unsigned i = 0; i < _num_levels * _num_slots; i ++) {
+            _slots[i] = NULL;
+        }
+        for (unsigned i = 0; i < _num_levels; i ++) {
+            _occupied[i] = 0;
+        }
+        _expired_head = _expired_tail = NULL;
+        _now = now;
+        _num_timers = 0;
+        return true;
+    }
+
+    /** Schedule a new timer
+      * @param delay number of ticks until the timer expires. A delay of 0 is handled like
+      *        a delay of 1 (the timer expires at the next tick).
+      * @param payload the payload of the timer (copied in the timer)
+      * @returns the handle of the new timer, or NULL if there are too many pending timers
+      */
+    handle_t schedule(uint32_t delay, const T& payload) {
+        void *p = _pool->alloc();
+        if (NULL == p)
+            return NULL;
+        lock_guard lock(_lock);
+        timer_node *node = new(p) timer_node(_now + (delay == 0 ? 1 : delay), payload);
+        _insert(node);
+        _num_timers ++;
+        return node;
+    }
+
+    /** Cancel a timer
+      * The payload of the timer is destroyed. A timer that has already expired, but whose
+      * payload was not yet returned by 'pop_expired', can also be cancelled.
+      * @param h the handle of the timer, as returned by 'schedule'. The handle is not valid
+      *        anymore after the call.
+      */
+    void cancel(handle_t h) {
+        {
+            lock_guard lock(_lock);
+            if (h->slot == _expired_slot) {
+                _unlink_expired(h);
+            } else {
+                _unlink(h);
+            }
+            _num_timers --;
+        }
+        h->~timer_node();
+        _pool->free(h);
+    }
+
+    /** Advance the time, moving all the timers that expire at or before 'now' to the
+      * list of expired timers (see 'pop_expired')
+      * @param now the new time (in ticks). It must not be more than 2^32 - 1 ticks after
+      *        the previous time.
+      */
+    void advance(uint32_t now) {
+        lock_guard lock(_lock);
+        uint32_t remaining = now - _now;
+        while (remaining > 0) {
+            // Find the next tick that expires or cascades timers
+            uint64_t step = _next_event();
+            if (step > remaining) {
+                _now = now;
+                break;
+            }
+            _now += (uint32_t)step;
+            remaining -= (uint32_t)step;
+            // Cascade the higher levels whose slot starts at this tick, from the highest one
+            for (unsigned level = _num_levels - 1; level > 0; level --) {
+                if ((_now & ((1UL << (_slot_bits * level)) - 1)) == 0) {
+                    _cascade(level, (_now >> (_slot_bits * level)) & _slot_mask);
+                }
+            }
+            // Level 0 timers expire at this tick
+            unsigned slot = _now & _slot_mask;
+            timer_node *node;
+            while ((node = _slots[slot]) != NULL) {
+                _unlink(node);
+                _append_expired(node);
+            }
+        }
+    }
+
+    /** Return the payload of an expired timer and release the timer
+      * @param payload receives the payload of the timer
+      * @returns true if an expired timer was found, false otherwise
+      */
+    bool pop_expired(T& payload) {
+        timer_node *node;
+        {
+            lock_guard lock(_lock);
+            if ((node = _expired_head) == NULL)
+                return false;
+            _unlink_expired(node);
+            _num_timers --;
+        }
+        payload = CORE_UTIL_MOVE(node->payload);
+        node->~timer_node();
+        _pool->free(node);
+        return true;
+    }
+
+    /** Returns the current time of the wheel (the last value given to 'advance')
+      * @returns the current time (in ticks)
+      */
+    uint32_t get_time() const {
+        return _now;
+    }
+
+    /** Returns the number of pending timers (scheduled or expired but not yet popped)
+      * @returns the number of timers
+      */
+    size_t get_num_timers() const {
+        return _num_timers;
+    }
+
+private:
+    static const unsigned _slot_bits = 6;
+    static const unsigned _num_slots = 1 << _slot_bits;
+    static const unsigned _slot_mask = _num_slots - 1;
+    static const unsigned _num_levels = (32 + _slot_bits - 1) / _slot_bits;
+    // 'slot' of the timers in the expired list
+    static const unsigned _expired_slot = _num_levels * _num_slots;
+
+    struct timer_node {
+        timer_node(uint32_t when, const T& p): expires(when), payload(p) {
+        }
+
+        timer_node *prev, *next;
+        uint32_t expires;
+        unsigned slot; // index in '_slots' or _expired_slot
+        T payload;
+    };
+
+    static unsigned _find_first_set(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        unsigned idx = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            idx ++;
+        }
+        return idx;
+#endif
+    }
+
+    void _insert(timer_node *node) {
+        // Choose the level from the distance to the expiration time, and the slot from the
+        // expiration time itself
+        uint32_t delta = node->expires - _now;
+        unsigned level = 0;
+        while ((level < _num_levels - 1) && (delta >= (1UL << (_slot_bits * (level + 1))))) {
+            level ++;
+        }
+        unsigned slot = (node->expires >> (_slot_bits * level)) & _slot_mask;
+        timer_node **head = &_slots[level * _num_slots + slot];
+        node->slot = level * _num_slots + slot;
+        node->prev = NULL;
+        node->next = *head;
+        if (*head != NULL)
+            (*head)->prev = node;
+        *head = node;
+        _occupied[level] |= (uint64_t)1 << slot;
+    }
+
+    void _unlink(timer_node *node) {
+        if (node->prev != NULL) {
+            node->prev->next = node->next;
+        } else {
+            _slots[node->slot] = node->next;
+            if (node->next == NULL)
+                _occupied[node->slot / _num_slots] &= ~((uint64_t)1 << (node->slot % _num_slots));
+        }
+        if (node->next != NULL)
+            node->next->prev = node->prev;
+    }
+
+    void _append_expired(timer_node *node) {
+        node->slot = _expired_slot;
+        node->next = NULL;
+        node->prev = _expired_tail;
+        if (_expired_tail != NULL) {
+            _expired_tail->next = node;
+        } else {
+            _expired_head = node;
+        }
+        _expired_tail = node;
+    }
+
+    void _unlink_expired(timer_node *node) {
+        if (node->prev != NULL) {
+            node->prev->next = node->next;
+        } else {
+            _expired_head = node->next;
+        }
+        if (node->next != NULL) {
+            node->next->prev = node->prev;
+        } else {
+            _expired_tail = node->prev;
+        }
+    }
+
+    void _cascade(unsigned level, unsigned slot) {
+        timer_node *node = _slots[level * _num_slots + slot];
+        _slots[level * _num_slots + slot] = NULL;
+        _occupied[level] &= ~((uint64_t)1 << slot);
+        while (node != NULL) {
+            timer_node *next = node->next;
+            _insert(node);
+            node = next;
+        }
+    }
+
+    // Returns the number of ticks until the next tick that has timers to expire or cascade
+    // (more than 2^32 - 1 if there are no scheduled timers)
+    uint64_t _next_event() const {
+        uint64_t step = (uint64_t)1 << 33;
+        for (unsigned level = 0; level < _num_levels; level ++) {
+            if (_occupied[level] == 0)
+                continue;
+            // Slot 's' is visited at the start of the first level 'level' period after
+            // the current one whose index ends in 's'. The top level has fewer slots,
+            // since the time is only 32 bits wide.
+            unsigned shift = _slot_bits * level;
+            unsigned width = 32 - shift < _slot_bits ? 32 - shift : _slot_bits;
+            unsigned slots = 1U << width;
+            uint64_t occupied = _occupied[level] & (~(uint64_t)0 >> (64 - slots));
+            uint64_t period = _now >> shift;
+            unsigned first = (unsigned)(period + 1) & (slots - 1);
+            // Rotate the bitmap right by 'first' within its 'slots' bits
+            uint64_t rotated = (occupied >> first) | (first ? (occupied << (slots - first)) : 0);
+            uint64_t start = (period + 1 + _find_first_set(rotated)) << shift;
+            if (start - _now < step)
+                step = start - _now;
+        }
+        return step;
+    }
+
+    void _destroy_list(timer_node *node) {
+        while (node != NULL) {
+            timer_node *next = node->next;
+            node->~timer_node();
+            node = next;
+        }
+    }
+
+    PoolAllocator *_pool;
+    void *_pool_storage;
+    timer_node *_slots[_num_levels * _num_slots];
+    uint64_t _occupied[_num_levels];
+    timer_node *_expired_head, *_expired_tail;
+    volatile uint32_t _now;
+    volatile size_t _num_timers;
+    typename LockTraits<Lock>::lock_type _lock;
+};
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifndef __MBED_UTIL_TIMING_WHEEL_H__
@@ -21,6 +21,33 @@
 #include <stdint.h>
 #include "core-util/CriticalSectionLock.h"
 
+/* Hosts built with GCC or Clang (POSIX targets and x86-64 builds) implement the
+ * atomic primitives below with the compiler's __atomic builtins instead of the
+ * generic CriticalSectionLock based implementation. Define
+ * MBED_UTIL_ATOMIC_NO_BUILTINS to force the generic implementation.
+ */
+#if !defined(MBED_UTIL_ATOMIC_NO_BUILTINS) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(TARGET_LIKE_POSIX) || defined(__x86_64__))
+#define MBED_UTIL_ATOMIC_USE_BUILTINS 1
+#endif
+
+/* atomic_dword must be aligned to its size for the double-width compare-and-swap
+ * instructions.
+ */
+#if defined(__GNUC__) || defined(__clang__) || defined(__CC_ARM)
+#define MBED_UTIL_ATOMIC_DWORD_ALIGN    __attribute__((aligned(2 * sizeof(uintptr_t))))
+#else
+#define MBED_UTIL_ATOMIC_DWORD_ALIGN
+#endif
+
+/* atomic_cas2 is lock-free on x86-64 (cmpxchg16b) and on 32-bit hosts with a
+ * native 64-bit compare-and-swap.
+ */
+#if defined(MBED_UTIL_ATOMIC_USE_BUILTINS) && (defined(__x86_64__) || \
+    ((__SIZEOF_POINTER__ == 4) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)))
+#define MBED_UTIL_ATOMIC_CAS2_LOCK_FREE 1
+#endif
+
 namespace mbed {
 namespace util {
 
@@ -133,6 +160,169 @@ template<typename T> T atomic_decr(T *valuePtr, T delta)
     }
 }
 
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+/* Specializations built on the compiler's __atomic builtins. They are lock-free
+ * for all the fixed width types below on the supported hosts, so they don't need
+ * to mask signals like the generic implementation does. All of them use
+ * sequentially consistent ordering, which matches the full barrier semantics of
+ * the generic implementation.
+ */
+#define MBED_UTIL_ATOMIC_BUILTIN_SPECIALIZATIONS(T)                                         \
+template<>                                                                                  \
+inline bool atomic_cas<T>(T *ptr, T *expectedCurrentValue, T desiredValue)                  \
+{                                                                                           \
+    return __atomic_compare_exchange_n(ptr, expectedCurrentValue, desiredValue, false,      \
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);                 \
+}                                                                                           \
+template<>                                                                                  \
+inline T atomic_incr<T>(T *valuePtr, T delta)                                               \
+{                                                                                           \
+    return __atomic_add_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);                           \
+}                                                                                           \
+template<>                                                                                  \
+inline T atomic_decr<T>(T *valuePtr, T delta)                                               \
+{                                                                                           \
+    return __atomic_sub_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);                           \
+}
+
+MBED_UTIL_ATOMIC_BUILTIN_SPECIALIZATIONS(uint8_t)
+MBED_UTIL_ATOMIC_BUILTIN_SPECIALIZATIONS(uint16_t)
+MBED_UTIL_ATOMIC_BUILTIN_SPECIALIZATIONS(uint32_t)
+MBED_UTIL_ATOMIC_BUILTIN_SPECIALIZATIONS(uint64_t)
+
+#undef MBED_UTIL_ATOMIC_BUILTIN_SPECIALIZATIONS
+
+/**
+ * Atomic compare and set for pointers. Same semantics as the generic atomic_cas
+ * above, but it is always implemented with a native compare-and-swap.
+ */
+template<typename T>
+inline bool atomic_cas(T **ptr, T **expectedCurrentValue, T *desiredValue)
+{
+    return __atomic_compare_exchange_n(ptr, expectedCurrentValue, desiredValue, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#endif /* #ifdef MBED_UTIL_ATOMIC_USE_BUILTINS */
+
+/**
+ * Two machine words that are compared and set together by atomic_cas2, for
+ * example a pointer and a modification tag that protects it against the ABA
+ * problem. It is 64 bits wide on 32-bit targets and 128 bits wide on 64-bit
+ * targets.
+ */
+struct MBED_UTIL_ATOMIC_DWORD_ALIGN atomic_dword {
+    uintptr_t lo;
+    uintptr_t hi;
+};
+
+/**
+ * Double-width atomic compare and set. Same semantics as atomic_cas, applied to
+ * both words of an atomic_dword at once.
+ *
+ * On x86-64 it is implemented with cmpxchg16b (which needs a CPU that supports
+ * it, like all but the earliest x86-64 CPUs). On 32-bit hosts that use the
+ * __atomic builtins it uses their 64-bit compare-and-swap. Everywhere else it
+ * uses the same critical section as the generic atomic_cas, which is atomic on
+ * single core targets. Use atomic_is_lock_free<atomic_dword> to find out at
+ * compile time which implementation is used.
+ *
+ * @param  ptr                  The target memory location.
+ * @param[in,out] expectedCurrentValue The expected current value, updated with
+ *                              the current value in the failure case.
+ * @param[in] desiredValue      The new value.
+ *
+ * @return                      true if the memory location was atomically
+ *                              updated with the desired value, false otherwise.
+ */
+inline bool atomic_cas2(atomic_dword *ptr, atomic_dword *expectedCurrentValue, atomic_dword desiredValue)
+{
+#if defined(MBED_UTIL_ATOMIC_CAS2_LOCK_FREE) && defined(__x86_64__)
+    // The builtins call libatomic for 16-byte types, so use the instruction directly
+    bool rc;
+    __asm__ __volatile__("lock cmpxchg16b %1\n\t"
+                         "sete %0"
+                         : "=q"(rc), "+m"(*ptr), "+a"(expectedCurrentValue->lo), "+d"(expectedCurrentValue->hi)
+                         : "b"(desiredValue.lo), "c"(desiredValue.hi)
+                         : "cc", "memory");
+    return rc;
+#elif defined(MBED_UTIL_ATOMIC_CAS2_LOCK_FREE)
+    return __atomic_compare_exchange(ptr, expectedCurrentValue, &desiredValue, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#else
+    CriticalSectionLock lock;
+
+    atomic_dword currentValue = *ptr;
+    if ((currentValue.lo == expectedCurrentValue->lo) && (currentValue.hi == expectedCurrentValue->hi)) {
+        *ptr = desiredValue;
+        return true;
+    }
+    *expectedCurrentValue = currentValue;
+    return false;
+#endif
+}
+
+/**
+ * Compile time check for the implementation of atomic_cas (and atomic_incr and
+ * atomic_decr, which are built on it) and atomic_cas2 for type T. 'value' is true
+ * if the operations use a native atomic instruction, and false if they use the
+ * generic implementation based on CriticalSectionLock. On embedded targets that
+ * implementation disables interrupts. On POSIX targets it is only atomic with
+ * respect to signal handlers of the calling thread that use
+ * CriticalSectionLock::defer_signal; it never excludes other threads. Code that
+ * can run on more than one core or thread, or that must not disable interrupts,
+ * can use it to choose between a lock-free algorithm and a lock based one.
+ */
+template<typename T>
+struct atomic_is_lock_free {
+    static const bool value = false;
+};
+
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+#define MBED_UTIL_ATOMIC_IS_LOCK_FREE(T)                                                    \
+template<>                                                                                  \
+struct atomic_is_lock_free<T> {                                                             \
+    static const bool value = __atomic_always_lock_free(sizeof(T), 0);                      \
+};
+
+MBED_UTIL_ATOMIC_IS_LOCK_FREE(uint8_t)
+MBED_UTIL_ATOMIC_IS_LOCK_FREE(uint16_t)
+MBED_UTIL_ATOMIC_IS_LOCK_FREE(uint32_t)
+MBED_UTIL_ATOMIC_IS_LOCK_FREE(uint64_t)
+
+#undef MBED_UTIL_ATOMIC_IS_LOCK_FREE
+
+template<typename T>
+struct atomic_is_lock_free<T*> {
+    static const bool value = true;
+};
+
+#ifdef MBED_UTIL_ATOMIC_CAS2_LOCK_FREE
+template<>
+struct atomic_is_lock_free<atomic_dword> {
+    static const bool value = true;
+};
+#endif
+#elif (__CORTEX_M >= 0x03)
+/* The load/store-exclusive specializations in atomic_ops.cpp. ARMv7-M has no
+ * doubleword exclusive access (LDREXD/STREXD are ARMv7-A/R only), so 64-bit
+ * values and atomic_dword use the generic implementation.
+ */
+template<>
+struct atomic_is_lock_free<uint8_t> {
+    static const bool value = true;
+};
+
+template<>
+struct atomic_is_lock_free<uint16_t> {
+    static const bool value = true;
+};
+
+template<>
+struct atomic_is_lock_free<uint32_t> {
+    static const bool value = true;
+};
+#endif
+
 } // namespace util
 } // namespace mbed
 
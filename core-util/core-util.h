@@ -50,5 +50,15 @@ void core_util_assert_internal(const char* expr, const char *fname, int line, co
 }
 #endif
 
+/* Move semantics are used when compiling for C++11 or newer. CORE_UTIL_MOVE(x)
+ * is std::move(x) in that case and a plain copy of 'x' otherwise. */
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#include <utility>
+#define CORE_UTIL_HAS_RVALUE_REFERENCES     1
+#define CORE_UTIL_MOVE(x)                   std::move(x)
+#else
+#define CORE_UTIL_MOVE(x)                   (x)
+#endif
+
 #endif // #ifndef __CORE_UTIL_MBED_UTIL_H__
 
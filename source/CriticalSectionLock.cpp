@@ -0,0 +1,58 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef TARGET_LIKE_POSIX
+
+#include "core-util/CriticalSectionLock.h"
+#include <signal.h>
+
+namespace mbed {
+namespace util {
+
+__thread volatile unsigned CriticalSectionLock::_depth;
+__thread volatile sig_atomic_t CriticalSectionLock::_pending;
+
+// The signals deferred by the current thread
+static __thread volatile sig_atomic_t deferred_signals[NSIG];
+
+bool CriticalSectionLock::defer_signal(int signum) {
+    if ((_depth == 0) || (signum <= 0) || (signum >= NSIG))
+        return false;
+    deferred_signals[signum] = 1;
+    _pending = 1;
+    return true;
+}
+
+void CriticalSectionLock::_raise_deferred_signals() {
+    // The deferred handlers run like the other handlers, outside any critical section. A
+    // signal deferred while they run (by a critical section in a handler) is found by the
+    // next iteration.
+    while (_pending) {
+        _pending = 0;
+        for (int signum = 1; signum < NSIG; signum ++) {
+            if (deferred_signals[signum]) {
+                deferred_signals[signum] = 0;
+                raise(signum);
+            }
+        }
+    }
+}
+
+} // namespace util
+} // namespace mbed
+
+#endif // #ifdef TARGET_LIKE_POSIX
@@ -17,7 +17,8 @@
 
 #include "core-util/ExtendablePoolAllocator.h"
 #include "core-util/PoolAllocator.h"
-#include "core-util/CriticalSectionLock.h"
+#include "core-util/LockPolicy.h"
+#include "core-util/atomic_ops.h"
 #include "ualloc/ualloc.h"
 #include <stddef.h>
 #include <stdint.h>
@@ -27,21 +28,29 @@
 namespace mbed {
 namespace util {
 
-ExtendablePoolAllocator::ExtendablePoolAllocator(): _head(NULL) {
+// Set in '_active' while empty pools are being released
+static const uint32_t reclaiming_flag = 0x80000000u;
+
+template<typename Lock>
+BasicExtendablePoolAllocator<Lock>::BasicExtendablePoolAllocator(): _head(NULL), _available(NULL), _directory(NULL), _empty_pools(0), _active(0),
+    _reserve(1), _auto_trim(false) {
 }
 
-bool ExtendablePoolAllocator::init(size_t initial_elements, size_t new_pool_elements, size_t element_size, UAllocTraits_t alloc_traits, unsigned alignment) {
+template<typename Lock>
+bool BasicExtendablePoolAllocator<Lock>::init(size_t initial_elements, size_t new_pool_elements, size_t element_size, UAllocTraits_t alloc_traits, unsigned alignment) {
+    lock_guard lock(_lock);
     if (_head != NULL)
         return false; // don't initialize twice
-    _new_pool_elements = new_pool_elements;
+    _growth = GrowthPolicy::fixed(new_pool_elements);
+    _capacity = 0;
     _element_size = PoolAllocator::align_up(element_size, alignment);
     _alloc_traits = alloc_traits;
     _alignment = alignment;
-    _head = create_new_pool(initial_elements, NULL);
-    return _head != NULL;
+    return add_new_pool(initial_elements) != NULL;
 }
 
-ExtendablePoolAllocator::~ExtendablePoolAllocator() {
+template<typename Lock>
+BasicExtendablePoolAllocator<Lock>::~BasicExtendablePoolAllocator() {
     pool_link *crt = _head, *prev;
     void *area;
     while (crt != NULL) {
@@ -51,44 +60,103 @@ ExtendablePoolAllocator::~ExtendablePoolAllocator() {
         mbed_ufree(area);
         crt = prev;
     }
+    pool_directory *dir = _directory, *retired;
+    while (dir != NULL) {
+        retired = dir->retired;
+        mbed_ufree(dir);
+        dir = retired;
+    }
 }
 
-void* ExtendablePoolAllocator::alloc() {
-    // Try the current pool first
+template<typename Lock>
+void* BasicExtendablePoolAllocator<Lock>::alloc() {
     if (NULL == _head)
         return NULL;
-    void *blk = _head->allocator.alloc();
+    const bool tracked = enter();
+    void *blk = alloc_internal();
+    leave(tracked);
+    return blk;
+}
+
+template<typename Lock>
+void* BasicExtendablePoolAllocator<Lock>::alloc_internal() {
+    // Try the current pool first
+    void *blk = alloc_from(_head);
     if (blk != NULL)
         return blk;
 
-    // Try all the other pools
+    // Try the pools that have free elements, dropping the full ones from the list
     pool_link *prev_head = _head;
-    pool_link *crt = prev_head->prev;
+    pool_link *crt = _available, *next;
     while (crt != NULL) {
-        if ((blk = crt->allocator.alloc()) != NULL) {
+        if ((blk = alloc_from(crt)) != NULL) {
             return blk;
         }
-        crt = crt->prev;
+        next = crt->next_available;
+        mark_full(crt);
+        crt = next;
     }
 
     // Not enough space, need to create another pool
     {
-        CriticalSectionLock lock; // execute with interrupts disabled
+        lock_guard lock(_lock);
         if (_head != prev_head) { // if someone else already allocated a new pool, use it
-            if ((blk = _head->allocator.alloc()) != NULL) {
+            if ((blk = alloc_from(_head)) != NULL) {
                 return blk;
             }
         }
         // Create a new pool and link it in the list of pools
-        if ((crt = create_new_pool(_new_pool_elements, _head)) != NULL) {
-            _head = crt;
-            return crt->allocator.alloc();
+        if ((crt = add_new_pool(_growth.get_increment(_capacity))) != NULL) {
+            return alloc_from(crt);
         }
     }
     return NULL;
 }
 
-void *ExtendablePoolAllocator::calloc() {
+template<typename Lock>
+size_t BasicExtendablePoolAllocator<Lock>::alloc_n(void **blocks, size_t n) {
+    if ((NULL == _head) || (0 == n))
+        return 0;
+    const bool tracked = enter();
+    size_t cnt = alloc_n_internal(blocks, n);
+    leave(tracked);
+    return cnt;
+}
+
+template<typename Lock>
+size_t BasicExtendablePoolAllocator<Lock>::alloc_n_internal(void **blocks, size_t n) {
+    // Take as many elements as possible from the current pool, then from the other pools
+    // that have free elements
+    pool_link *prev_head = _head, *next;
+    size_t cnt = alloc_n_from(prev_head, blocks, n);
+    for (pool_link *crt = _available; (crt != NULL) && (cnt < n); crt = next) {
+        cnt += alloc_n_from(crt, blocks + cnt, n - cnt);
+        next = crt->next_available;
+        if (cnt < n) {
+            mark_full(crt);
+        }
+    }
+
+    // Create new pools until the request is satisfied
+    while (cnt < n) {
+        lock_guard lock(_lock);
+        pool_link *crt;
+        if (_head != prev_head) { // if someone else already allocated a new pool, use it
+            prev_head = _head;
+            cnt += alloc_n_from(prev_head, blocks + cnt, n - cnt);
+            continue;
+        }
+        if ((crt = add_new_pool(_growth.get_increment(_capacity))) == NULL) {
+            break;
+        }
+        prev_head = crt;
+        cnt += alloc_n_from(crt, blocks + cnt, n - cnt);
+    }
+    return cnt;
+}
+
+template<typename Lock>
+void *BasicExtendablePoolAllocator<Lock>::calloc() {
     uint32_t *blk = (uint32_t*)alloc();
 
     if (blk == NULL)
@@ -98,20 +166,65 @@ void *ExtendablePoolAllocator::calloc() {
     return blk;
 }
 
-void ExtendablePoolAllocator::free(void *p) {
-    pool_link *crt = _head;
-
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::free(void *p) {
     // Delegate freeing to the pool that owns the pointer
-    while (crt != NULL) {
-        if (crt->allocator.owns(p)) {
-            crt->allocator.free(p);
-            return;
+    const bool tracked = enter();
+    pool_link *crt = find_pool(p);
+    bool trim = false;
+    if (crt != NULL) {
+        crt->allocator.free(p);
+        trim = account_free(crt, 1);
+    }
+    leave(tracked);
+    // Pools can only be released after this operation stopped using them
+    if (trim) {
+        release_empty_pools(false);
+    }
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::free_n(void **blocks, size_t n) {
+    size_t i = 0, j;
+    bool trim = false;
+    const bool tracked = enter();
+    while (i < n) {
+        pool_link *crt = find_pool(blocks[i]);
+        if (NULL == crt) {
+            i ++;
+            continue;
         }
-        crt = crt->prev;
+        // Free the whole run of elements that belong to the same pool at once
+        for (j = i + 1; (j < n) && crt->allocator.owns(blocks[j]); j ++);
+        crt->allocator.free_n(blocks + i, j - i);
+        trim = account_free(crt, j - i) || trim;
+        i = j;
+    }
+    leave(tracked);
+    if (trim) {
+        release_empty_pools(false);
     }
 }
 
-unsigned ExtendablePoolAllocator::get_num_pools() const {
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::set_growth_policy(const GrowthPolicy& growth) {
+    lock_guard lock(_lock);
+    _growth = growth;
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::set_trim_policy(size_t reserve, bool auto_trim) {
+    _reserve = reserve;
+    _auto_trim = auto_trim;
+}
+
+template<typename Lock>
+size_t BasicExtendablePoolAllocator<Lock>::trim() {
+    return release_empty_pools(true);
+}
+
+template<typename Lock>
+unsigned BasicExtendablePoolAllocator<Lock>::get_num_pools() const {
     pool_link *crt = _head;
     unsigned cnt = 0;
 
@@ -122,11 +235,53 @@ unsigned ExtendablePoolAllocator::get_num_pools() const {
     return cnt;
 }
 
-ExtendablePoolAllocator::pool_link* ExtendablePoolAllocator::create_new_pool(size_t elements, pool_link *prev) const {
+template<typename Lock>
+typename BasicExtendablePoolAllocator<Lock>::pool_link* BasicExtendablePoolAllocator<Lock>::find_pool(void *p) const {
+    pool_link *crt = _head;
+
+    // Most of the time the element belongs to the current pool
+    if ((crt != NULL) && crt->allocator.owns(p)) {
+        return crt;
+    }
+
+    // Binary search for the first pool placed after 'p' in the directory
+    pool_directory *dir = _directory;
+    if (dir != NULL) {
+        size_t low = 0, high = dir->num_pools;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if ((void*)dir->pools[mid] <= p) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if ((low < dir->num_pools) && dir->pools[low]->allocator.owns(p)) {
+            return dir->pools[low];
+        }
+    }
+
+    // Not found. Either 'p' doesn't belong to this allocator, or the directory is being
+    // updated by another context (or couldn't be allocated): check all the pools.
+    // Pools are released with the lock held, so they can't go away during the walk.
+    lock_guard lock(_lock);
+    crt = _head;
+    while (crt != NULL) {
+        if (crt->allocator.owns(p)) {
+            return crt;
+        }
+        crt = crt->prev;
+    }
+    return NULL;
+}
+
+template<typename Lock>
+typename BasicExtendablePoolAllocator<Lock>::pool_link* BasicExtendablePoolAllocator<Lock>::create_new_pool(size_t elements, pool_link *prev) const {
     // Create a pool instance + the actual pool space + a link to the previous pool allocator in the chain in a contigous memory area.
     // Layout: pool storage area | pool_link structure (pointer to previous pool and PoolAllocator instance)
-    // Since the pool storage area aligns all the allocations internally to at least 4 bytes, the pool_link address will be correctly aligned
+    // The PoolAllocator inside pool_link has a 64-bit member, so the storage area is padded to keep the pool_link 8-byte aligned
     size_t pool_storage_size = PoolAllocator::get_pool_size(elements, _element_size, _alignment);
+    pool_storage_size = PoolAllocator::align_up(pool_storage_size, sizeof(uint64_t));
     void *temp = mbed_ualloc(pool_storage_size + sizeof(pool_link), _alloc_traits);
     if (temp == NULL)
         return NULL;
@@ -134,6 +289,249 @@ ExtendablePoolAllocator::pool_link* ExtendablePoolAllocator::create_new_pool(siz
     return p;
 }
 
+template<typename Lock>
+typename BasicExtendablePoolAllocator<Lock>::pool_link* BasicExtendablePoolAllocator<Lock>::add_new_pool(size_t elements) {
+    // Called with the lock held
+    if (0 == elements)
+        return NULL;
+    // A pool can't hold more elements than its free list head can index. Clamp before
+    // sizing the storage, so that 'capacity' matches what the pool can really hand out
+    // (otherwise a full pool would never look full to mark_full())
+    if (elements > PoolAllocator::get_max_elements())
+        elements = PoolAllocator::get_max_elements();
+    pool_link *crt = create_new_pool(elements, _head);
+    if (crt != NULL) {
+        _capacity += elements;
+        _head = crt;
+        add_to_directory(crt);
+        link_available(crt);
+        atomic_incr(&_empty_pools, 1u);
+    }
+    return crt;
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::mark_available(pool_link *pool) {
+    lock_guard lock(_lock);
+    link_available(pool);
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::link_available(pool_link *pool) {
+    // Called with the lock held
+    if (pool->available)
+        return;
+    pool->next_available = _available;
+    pool->available = 1;
+    _available = pool;
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::mark_full(pool_link *pool) {
+    lock_guard lock(_lock);
+    uint32_t available = 1;
+    // The CAS orders this update before the check of 'live' below, which pairs with
+    // account_free() updating 'live' before checking 'available'
+    if (!atomic_cas(&pool->available, &available, 0u))
+        return;
+    unlink_available(pool);
+    // An element might have been freed after the failed allocation, in which case
+    // account_free() didn't put the pool back in the list (it was still there)
+    if (pool->live < pool->capacity) {
+        link_available(pool);
+    }
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::unlink_available(pool_link *pool) {
+    pool_link *volatile *crt = &_available;
+    while (*crt != NULL) {
+        if (*crt == pool) {
+            *crt = pool->next_available;
+            pool->available = 0;
+            return;
+        }
+        crt = &(*crt)->next_available;
+    }
+}
+
+template<typename Lock>
+void* BasicExtendablePoolAllocator<Lock>::alloc_from(pool_link *pool) {
+    void *blk = pool->allocator.alloc();
+    if (blk != NULL) {
+        account_alloc(pool, 1);
+    }
+    return blk;
+}
+
+template<typename Lock>
+size_t BasicExtendablePoolAllocator<Lock>::alloc_n_from(pool_link *pool, void **blocks, size_t n) {
+    size_t cnt = pool->allocator.alloc_n(blocks, n);
+    if (cnt > 0) {
+        account_alloc(pool, cnt);
+    }
+    return cnt;
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::account_alloc(pool_link *pool, size_t n) {
+    if (atomic_incr(&pool->live, (uint32_t)n) == n) { // the pool was empty
+        atomic_decr(&_empty_pools, 1u);
+    }
+}
+
+template<typename Lock>
+bool BasicExtendablePoolAllocator<Lock>::account_free(pool_link *pool, size_t n) {
+    uint32_t live = atomic_decr(&pool->live, (uint32_t)n);
+    if (!pool->available) {
+        mark_available(pool);
+    }
+    if (0 == live) { // the pool is now empty
+        // Besides the current pool, keep up to '_reserve' empty pools before releasing any
+        return (atomic_incr(&_empty_pools, 1u) > _reserve + 1) && _auto_trim;
+    }
+    return false;
+}
+
+template<typename Lock>
+bool BasicExtendablePoolAllocator<Lock>::enter() {
+    if (!_auto_trim)
+        return false;
+    uint32_t active = _active;
+    while (true) {
+        if (active & reclaiming_flag) {
+            // Pools are being released with the lock held, wait until that's done
+            {
+                lock_guard lock(_lock);
+            }
+            active = _active;
+            continue;
+        }
+        if (atomic_cas(&_active, &active, active + 1)) {
+            return true;
+        }
+    }
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::leave(bool tracked) {
+    if (tracked) {
+        atomic_decr(&_active, 1u);
+    }
+}
+
+template<typename Lock>
+size_t BasicExtendablePoolAllocator<Lock>::release_empty_pools(bool maintenance) {
+    lock_guard lock(_lock);
+    size_t released = 0, kept = 0;
+
+    if (NULL == _head)
+        return 0;
+    // Don't release anything while another operation might be using one of the pools, and
+    // keep new operations from starting until the pools are released
+    uint32_t idle = 0;
+    if (!atomic_cas(&_active, &idle, reclaiming_flag))
+        return 0;
+    // The current pool is never released
+    pool_link *succ = _head, *crt;
+    while ((crt = succ->prev) != NULL) {
+        if ((crt->live == 0) && (kept ++ >= _reserve)) {
+            succ->prev = crt->prev;
+            remove_from_directory(crt);
+            unlink_available(crt);
+            atomic_decr(&_empty_pools, 1u);
+            _capacity -= crt->capacity;
+            void *area = crt->allocator.get_start_address();
+            crt->~pool_link();
+            mbed_ufree(area);
+            released ++;
+        } else {
+            succ = crt;
+        }
+    }
+    // In a maintenance window nothing can be using the old directories anymore
+    if (maintenance && (_directory != NULL)) {
+        pool_directory *dir = _directory->retired, *retired;
+        _directory->retired = NULL;
+        while (dir != NULL) {
+            retired = dir->retired;
+            mbed_ufree(dir);
+            dir = retired;
+        }
+    }
+    atomic_decr(&_active, reclaiming_flag);
+    return released;
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::remove_from_directory(pool_link *pool) {
+    pool_directory *dir = _directory;
+    if (NULL == dir)
+        return;
+    size_t n = dir->num_pools, pos = 0;
+    while ((pos < n) && (dir->pools[pos] != pool)) {
+        pos ++;
+    }
+    if (pos == n)
+        return;
+    // Shift the other entries over the removed one before shrinking the directory, so
+    // that a concurrent find_pool() only sees a sorted array
+    for (size_t i = pos; i < n - 1; i ++) {
+        dir->pools[i] = dir->pools[i + 1];
+    }
+    dir->num_pools = n - 1;
+}
+
+template<typename Lock>
+void BasicExtendablePoolAllocator<Lock>::add_to_directory(pool_link *pool) {
+    // Called with the lock held
+    pool_directory *dir = _directory;
+
+    if ((NULL == dir) || (dir->num_pools == dir->capacity)) {
+        // Create a larger directory. The old one might still be used by a concurrent
+        // find_pool(), so it is only freed in the destructor.
+        size_t capacity = (NULL == dir) ? 4 : dir->capacity * 2;
+        pool_directory *new_dir = (pool_directory*)mbed_ualloc(sizeof(pool_directory) + (capacity - 1) * sizeof(pool_link*), _alloc_traits);
+        if (NULL == new_dir)
+            return; // find_pool() will fall back to checking all the pools
+        new_dir->retired = dir;
+        new_dir->capacity = capacity;
+        new_dir->num_pools = 0;
+        if (dir != NULL) {
+            for (size_t i = 0; i < dir->num_pools; i ++) {
+                new_dir->pools[i] = dir->pools[i];
+            }
+            new_dir->num_pools = dir->num_pools;
+        }
+        _directory = dir = new_dir;
+    }
+
+    // Insert the new pool in place, keeping the directory sorted. The entries are shifted
+    // so that a concurrent find_pool() only sees a sorted array (or misses the pool and
+    // falls back to checking all the pools)
+    size_t n = dir->num_pools, pos = n;
+    while ((pos > 0) && (dir->pools[pos - 1] > pool)) {
+        pos --;
+    }
+    if (pos < n) {
+        dir->pools[n] = dir->pools[n - 1];
+        dir->num_pools = n + 1;
+        for (size_t i = n - 1; i > pos; i --) {
+            dir->pools[i] = dir->pools[i - 1];
+        }
+        dir->pools[pos] = pool;
+    } else {
+        dir->pools[n] = pool;
+        dir->num_pools = n + 1;
+    }
+}
+
+template class BasicExtendablePoolAllocator<CriticalSectionLock>;
+template class BasicExtendablePoolAllocator<NullLock>;
+template class BasicExtendablePoolAllocator<SpinLock>;
+template class BasicExtendablePoolAllocator<TicketLock>;
+template class BasicExtendablePoolAllocator<MCSLock>;
+
 } // namespace util
 } // namespace mbed
 
@@ -21,39 +21,162 @@
 #include <stdio.h>
 
 #include "core-util/atomic_ops.h"
+#include "core-util/core-util.h"
 
 namespace mbed {
 namespace util {
 
-PoolAllocator::PoolAllocator(void *start, size_t elements, size_t element_size, size_t alignment):
+const PoolAllocator::link_t PoolAllocator::_null_link;
+const unsigned PoolAllocator::_head_index_bits;
+const PoolAllocator::head_t PoolAllocator::_head_null_index;
+
+PoolAllocator::PoolAllocator(void *start, size_t elements, size_t element_size, unsigned alignment):
     _start(start), _element_size(element_size) {
     _element_size = align_up(element_size, alignment);
+    // The free list head can't index more elements. Don't hand out only a part of an
+    // oversized pool: if the assert is compiled out, the pool is created empty
+    CORE_UTIL_ASSERT_MSG(elements <= get_max_elements(), "too many elements in PoolAllocator");
+    if (elements > get_max_elements())
+        elements = 0;
+    _elements = (link_t)elements;
     _end = (void*)((uint8_t*)start + _element_size * elements);
     _init();
 }
 
 void* PoolAllocator::alloc() {
-    uint32_t prev_free = (uint32_t)_free_block;
-    if (0 == prev_free)
-        return NULL;
+    head_t head = _free_head;
     while (true) {
-        void **const new_free = (void **)(*((void **)prev_free));
-        if (atomic_cas((uint32_t*)&_free_block, &prev_free, (uint32_t)new_free)) {
-            return (void*)prev_free;
+        link_t first = _head_link(head);
+        if (_null_link == first) {
+            size_t cnt;
+            return _alloc_fresh(1, &cnt);
+        }
+        // If another context allocates 'first' before our CAS, 'next' might be garbage,
+        // but then the tag will have changed and the CAS below will fail
+        void *blk = _get_element(first);
+        link_t next = *((link_t *)blk);
+        if (atomic_cas(&_free_head, &head, _make_head(next, _head_tag(head) + 1))) {
+            return blk;
         }
     }
 }
 
 void PoolAllocator::free(void* p) {
     if (owns(p)) {
-        uint32_t prev_free = (uint32_t)_free_block;
+        _free_chain(p, p);
+    }
+}
+
+size_t PoolAllocator::alloc_n(void **blocks, size_t n) {
+    if (0 == n)
+        return 0;
+    size_t cnt;
+    void *blk = _alloc_chain(n, &cnt);
+    for (size_t i = 0; i < cnt; i ++) {
+        blocks[i] = blk;
+        blk = _get_next(blk);
+    }
+    return cnt;
+}
+
+void PoolAllocator::free_n(void **blocks, size_t n) {
+    // Link all the elements in a chain, then give it back to the pool
+    void *first = NULL, *last = NULL;
+    for (size_t i = 0; i < n; i ++) {
+        if (!owns(blocks[i]))
+            continue;
+        if (NULL == last)
+            last = blocks[i];
+        _set_next(blocks[i], first);
+        first = blocks[i];
+    }
+    if (first != NULL) {
+        _free_chain(first, last);
+    }
+}
+
+void* PoolAllocator::_alloc_chain(size_t n, size_t *count) {
+    head_t head = _free_head;
+    void *chain = NULL;
+    *count = 0;
+    while (true) {
+        link_t first = _head_link(head);
+        if (_null_link == first)
+            break;
+        // Find the last element of the chain. Another context might allocate from the
+        // pool while we walk it, in which case the links can contain garbage; stop and
+        // retry if a link doesn't point to an element in the pool (the CAS would fail anyway)
+        link_t last = first, next;
+        size_t cnt = 1;
         while (true) {
-            *((void**)p) = (void*)prev_free;
-            if (atomic_cas((uint32_t*)&_free_block, &prev_free, (uint32_t)p)) {
+            next = *((link_t *)_get_element(last));
+            if ((cnt == n) || (_null_link == next) || (next >= _elements))
                 break;
-            }
+            last = next;
+            cnt ++;
+        }
+        if ((_null_link != next) && (next >= _elements)) {
+            head = _free_head;
+            continue;
+        }
+        if (atomic_cas(&_free_head, &head, _make_head(next, _head_tag(head) + 1))) {
+            *((link_t *)_get_element(last)) = _null_link;
+            *count = cnt;
+            chain = _get_element(first);
+            break;
+        }
+    }
+    if (*count < n) {
+        // Not enough elements in the free list, complete the chain with fresh elements
+        size_t fresh;
+        uint8_t *blk = (uint8_t *)_alloc_fresh(n - *count, &fresh);
+        if (fresh > 0) {
+            link_t next = (link_t)((blk - (uint8_t *)_start) / _element_size) + 1;
+            for (size_t i = 1; i < fresh; i ++, blk += _element_size)
+                *((link_t *)blk) = next ++;
+            _set_next(blk, chain);
+            chain = blk - (fresh - 1) * _element_size;
+            *count += fresh;
         }
     }
+    return chain;
+}
+
+void* PoolAllocator::_alloc_fresh(size_t n, size_t *count) {
+    const link_t pool_size = (link_t)((uint8_t *)_end - (uint8_t *)_start);
+    link_t bump = _bump;
+    while (true) {
+        if (bump >= pool_size) {
+            *count = 0;
+            return NULL;
+        }
+        link_t new_bump = bump;
+        size_t cnt = 0;
+        while ((cnt < n) && (new_bump < pool_size)) {
+            new_bump += _element_size;
+            cnt ++;
+        }
+        if (atomic_cas(&_bump, &bump, new_bump)) {
+            *count = cnt;
+            return (uint8_t *)_start + bump;
+        }
+    }
+}
+
+void PoolAllocator::_free_chain(void *first, void *last) {
+    const link_t link = (link_t)(((uint8_t *)first - (uint8_t *)_start) / _element_size);
+    head_t head = _free_head;
+    while (true) {
+        *((link_t *)last) = _head_link(head);
+        if (atomic_cas(&_free_head, &head, _make_head(link, _head_tag(head) + 1))) {
+            break;
+        }
+    }
+}
+
+size_t PoolAllocator::get_max_elements() {
+    // The largest index is reserved for the end of the free list
+    return (size_t)_head_null_index;
 }
 
 bool PoolAllocator::owns(void *p) const {
@@ -84,22 +207,10 @@ void* PoolAllocator::get_start_address() const {
 }
 
 void PoolAllocator::_init() {
-    _free_block = _start;
-
-    // Link all free blocks using offsets.
-    void* next;
-    void* blk = _free_block;
-
-    while(true) {
-        next = ((uint8_t *) blk) + _element_size;
-        if(next > _end)
-            break;
-        *((void **)blk) = next;
-        blk = next;
-    }
-    // count back one block and mark it as the last one
-    blk = ((uint8_t *) blk) - _element_size;
-    *((void **)blk) = 0;
+    // Nothing is linked in advance: the free list starts empty and all the elements
+    // are handed out by _alloc_fresh() until they are freed for the first time
+    _free_head = _make_head(_null_link, 0);
+    _bump = 0;
 }
 
 } // namespace util
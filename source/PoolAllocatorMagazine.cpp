@@ -0,0 +1,83 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/PoolAllocatorMagazine.h"
+#include "core-util/PoolAllocator.h"
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mbed {
+namespace util {
+
+PoolAllocatorMagazine::PoolAllocatorMagazine(PoolAllocator& pool, size_t capacity):
+    _pool(pool), _top(NULL), _count(0), _capacity(capacity) {
+    if (_capacity == 0)
+        _capacity = 1;
+    _batch = (_capacity + 1) / 2;
+}
+
+PoolAllocatorMagazine::~PoolAllocatorMagazine() {
+    flush();
+}
+
+void* PoolAllocatorMagazine::alloc() {
+    if (NULL == _top) {
+        // Refill the magazine with a batch of elements from the pool
+        if ((_top = _pool._alloc_chain(_batch, &_count)) == NULL)
+            return NULL;
+    }
+    void *blk = _top;
+    _top = _pool._get_next(blk);
+    _count --;
+    return blk;
+}
+
+void PoolAllocatorMagazine::free(void *p) {
+    if (!_pool.owns(p))
+        return;
+    if (_count == _capacity) {
+        // Return a batch of elements from the top of the magazine to the pool
+        void *first = _top, *last = _top;
+        for (size_t i = 1; i < _batch; i ++)
+            last = _pool._get_next(last);
+        _top = _pool._get_next(last);
+        _count -= _batch;
+        _pool._free_chain(first, last);
+    }
+    _pool._set_next(p, _top);
+    _top = p;
+    _count ++;
+}
+
+void PoolAllocatorMagazine::flush() {
+    if (NULL == _top)
+        return;
+    void *last = _top;
+    while (_pool._get_next(last) != NULL)
+        last = _pool._get_next(last);
+    _pool._free_chain(_top, last);
+    _top = NULL;
+    _count = 0;
+}
+
+size_t PoolAllocatorMagazine::get_num_cached() const {
+    return _count;
+}
+
+} // namespace util
+} // namespace mbed
+
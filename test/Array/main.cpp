@@ -143,6 +143,186 @@ static void test_non_pod() {
     MBED_HOSTTEST_ASSERT(array.get_num_zones() == 1);
 }
 
+static void test_growth_policy() {
+    const size_t initial_capacity = 4, total = 1024;
+    UAllocTraits_t traits = {0};
+
+    // Doubling: the number of zones is logarithmic in the number of elements
+    Array<unsigned> doubling;
+    MBED_HOSTTEST_ASSERT(doubling.init(initial_capacity, initial_capacity, traits));
+    doubling.set_growth_policy(GrowthPolicy::doubling(initial_capacity));
+    // Doubling, but never add more than 64 elements at once
+    Array<unsigned> capped;
+    MBED_HOSTTEST_ASSERT(capped.init(initial_capacity, initial_capacity, traits));
+    capped.set_growth_policy(GrowthPolicy::doubling(initial_capacity, 64));
+    // Factor of 1.5
+    Array<unsigned> factor_1_5;
+    MBED_HOSTTEST_ASSERT(factor_1_5.init(initial_capacity, initial_capacity, traits));
+    factor_1_5.set_growth_policy(GrowthPolicy::factor_1_5(initial_capacity));
+
+    for (unsigned i = 0; i < total; i ++) {
+        MBED_HOSTTEST_ASSERT(doubling.push_back(i));
+        MBED_HOSTTEST_ASSERT(capped.push_back(i));
+        MBED_HOSTTEST_ASSERT(factor_1_5.push_back(i));
+    }
+    for (unsigned i = 0; i < total; i ++) {
+        MBED_HOSTTEST_ASSERT(doubling[i] == i);
+        MBED_HOSTTEST_ASSERT(capped[i] == i);
+        MBED_HOSTTEST_ASSERT(factor_1_5[i] == i);
+    }
+    MBED_HOSTTEST_ASSERT(doubling.get_capacity() == total);
+    MBED_HOSTTEST_ASSERT(doubling.get_num_zones() == 9); // 4, 8, 16, ... 1024
+    MBED_HOSTTEST_ASSERT(capped.get_num_zones() == 20); // 4, 8, ... 64, 128, 192, ... 1024
+    MBED_HOSTTEST_ASSERT(factor_1_5.get_num_zones() < 20);
+
+    // Indexing over many zones with a fixed increment and with a first zone that is
+    // not a power of two
+    Array<unsigned> uniform, odd_doubling;
+    MBED_HOSTTEST_ASSERT(uniform.init(5, 7, traits));
+    MBED_HOSTTEST_ASSERT(odd_doubling.init(5, 5, traits));
+    odd_doubling.set_growth_policy(GrowthPolicy::doubling(5));
+    for (unsigned i = 0; i < total; i ++) {
+        MBED_HOSTTEST_ASSERT(uniform.push_back(i));
+        MBED_HOSTTEST_ASSERT(odd_doubling.push_back(i));
+    }
+    for (unsigned i = 0; i < total; i ++) {
+        MBED_HOSTTEST_ASSERT(uniform[i] == i);
+        MBED_HOSTTEST_ASSERT(odd_doubling[i] == i);
+    }
+    MBED_HOSTTEST_ASSERT(uniform.get_num_zones() == 1 + (total - 5 + 6) / 7);
+    MBED_HOSTTEST_ASSERT(odd_doubling.get_num_zones() == 9); // 5, 10, 20, ... 1280
+
+    // A fixed policy with no increment prevents the array from growing
+    Array<unsigned> fixed;
+    MBED_HOSTTEST_ASSERT(fixed.init(initial_capacity, initial_capacity, traits));
+    fixed.set_growth_policy(GrowthPolicy::fixed(0));
+    for (unsigned i = 0; i < initial_capacity; i ++) {
+        MBED_HOSTTEST_ASSERT(fixed.push_back(i));
+    }
+    MBED_HOSTTEST_ASSERT(!fixed.push_back(initial_capacity));
+    MBED_HOSTTEST_ASSERT(fixed.get_num_zones() == 1);
+    // A failed push_back doesn't reserve a slot
+    MBED_HOSTTEST_ASSERT(fixed.get_num_elements() == initial_capacity);
+    fixed.pop_back();
+    MBED_HOSTTEST_ASSERT(fixed.push_back(initial_capacity));
+    MBED_HOSTTEST_ASSERT(fixed[initial_capacity - 1] == initial_capacity);
+}
+
+static void test_append() {
+    UAllocTraits_t traits = {0};
+    unsigned values[100];
+    for (unsigned i = 0; i < 100; i ++) {
+        values[i] = i;
+    }
+
+    // reserve() allocates a single zone, so appending doesn't need to grow the array
+    Array<unsigned> reserved;
+    MBED_HOSTTEST_ASSERT(!reserved.reserve(100)); // not initialized
+    MBED_HOSTTEST_ASSERT(reserved.init(10, 10, traits));
+    MBED_HOSTTEST_ASSERT(reserved.reserve(100));
+    MBED_HOSTTEST_ASSERT(reserved.get_capacity() == 100);
+    MBED_HOSTTEST_ASSERT(reserved.reserve(50));
+    MBED_HOSTTEST_ASSERT(reserved.get_num_zones() == 2);
+    MBED_HOSTTEST_ASSERT(reserved.append(values, 100));
+    MBED_HOSTTEST_ASSERT(reserved.get_num_zones() == 2);
+    MBED_HOSTTEST_ASSERT(reserved.get_num_elements() == 100);
+    for (unsigned i = 0; i < 100; i ++) {
+        MBED_HOSTTEST_ASSERT(reserved[i] == i);
+    }
+
+    // Appended runs that span zone boundaries
+    Array<unsigned> array;
+    MBED_HOSTTEST_ASSERT(array.init(10, 10, traits));
+    MBED_HOSTTEST_ASSERT(array.append(values, 7));
+    MBED_HOSTTEST_ASSERT(array.append(values + 7, 0));
+    MBED_HOSTTEST_ASSERT(array.append(values + 7, 5)); // 3 in the first zone, 2 in a new one
+    MBED_HOSTTEST_ASSERT(array.get_num_zones() == 2);
+    MBED_HOSTTEST_ASSERT(array.append(values + 12, 88)); // grows by more than 'grow_capacity'
+    MBED_HOSTTEST_ASSERT(array.get_num_zones() == 3);
+    MBED_HOSTTEST_ASSERT(array.push_back(100));
+    MBED_HOSTTEST_ASSERT(array.get_num_elements() == 101);
+    for (unsigned i = 0; i < 101; i ++) {
+        MBED_HOSTTEST_ASSERT(array[i] == i);
+    }
+
+    // Non-POD elements are copy-constructed
+    Test tests[15];
+    for (unsigned i = 0; i < 15; i ++) {
+        tests[i] = Test(i, 'c');
+    }
+    {
+        Array<Test> objects;
+        MBED_HOSTTEST_ASSERT(objects.init(4, 4, traits, 4));
+        MBED_HOSTTEST_ASSERT(objects.append(tests, 15));
+        MBED_HOSTTEST_ASSERT(Test::inst_count == 30);
+        for (unsigned i = 0; i < 15; i ++) {
+            MBED_HOSTTEST_ASSERT(objects[i] == Test(i, 'c'));
+        }
+    }
+    MBED_HOSTTEST_ASSERT(Test::inst_count == 15);
+
+    // clear() destroys the elements but keeps the memory
+    {
+        Array<Test> objects;
+        MBED_HOSTTEST_ASSERT(objects.init(4, 4, traits, 4));
+        MBED_HOSTTEST_ASSERT(objects.append(tests, 10));
+        objects.clear();
+        MBED_HOSTTEST_ASSERT(Test::inst_count == 15);
+        MBED_HOSTTEST_ASSERT(objects.get_num_elements() == 0);
+        MBED_HOSTTEST_ASSERT(objects.get_capacity() == 10);
+        MBED_HOSTTEST_ASSERT(objects.append(tests, 12));
+        MBED_HOSTTEST_ASSERT(objects.get_num_zones() == 3);
+        MBED_HOSTTEST_ASSERT(objects[11] == Test(11, 'c'));
+    }
+    MBED_HOSTTEST_ASSERT(Test::inst_count == 15);
+}
+
+#ifdef CORE_UTIL_HAS_RVALUE_REFERENCES
+static void test_move() {
+    UAllocTraits_t traits = {0};
+    Array<Test> array;
+    MBED_HOSTTEST_ASSERT(array.init(2, 2, traits));
+
+    // Both push_back(T&&) and emplace_back construct a single instance in the array
+    Test t(1, 'm');
+    MBED_HOSTTEST_ASSERT(array.push_back(static_cast<Test&&>(t)));
+    MBED_HOSTTEST_ASSERT(Test::inst_count == 2);
+    MBED_HOSTTEST_ASSERT(array.emplace_back(2, 'e'));
+    MBED_HOSTTEST_ASSERT(array.emplace_back(3, 'e'));
+    MBED_HOSTTEST_ASSERT(Test::inst_count == 4);
+    MBED_HOSTTEST_ASSERT(array.get_num_zones() == 2);
+    MBED_HOSTTEST_ASSERT(array[0] == Test(1, 'm'));
+    MBED_HOSTTEST_ASSERT(array[1] == Test(2, 'e'));
+    MBED_HOSTTEST_ASSERT(array[2] == Test(3, 'e'));
+}
+#endif
+
+// An Array with the NullLock policy reserves and publishes slots without atomic operations
+static void test_single_context() {
+    UAllocTraits_t traits = {0};
+    unsigned values[30];
+    for (unsigned i = 0; i < 30; i ++) {
+        values[i] = i;
+    }
+    Array<unsigned, NullLock> array;
+    MBED_HOSTTEST_ASSERT(array.init(8, 8, traits));
+    for (unsigned i = 0; i < 20; i ++) {
+        MBED_HOSTTEST_ASSERT(array.push_back(i));
+        MBED_HOSTTEST_ASSERT(array.get_num_elements() == i + 1);
+    }
+    MBED_HOSTTEST_ASSERT(array.append(values + 20, 10));
+    MBED_HOSTTEST_ASSERT(array.get_num_elements() == 30);
+    array.pop_back();
+    MBED_HOSTTEST_ASSERT(array.push_back(29));
+    for (unsigned i = 0; i < 30; i ++) {
+        MBED_HOSTTEST_ASSERT(array[i] == i);
+    }
+    array.clear();
+    MBED_HOSTTEST_ASSERT(array.get_num_elements() == 0);
+    MBED_HOSTTEST_ASSERT(array.push_back(5));
+    MBED_HOSTTEST_ASSERT((array.get_num_elements() == 1) && (array[0] == 5));
+}
+
 void app_start(int, char**) {
     MBED_HOSTTEST_TIMEOUT(5);
     MBED_HOSTTEST_SELECT(default);
@@ -151,6 +331,12 @@ void app_start(int, char**) {
 
     test_pod(); // test with "plain old data"
     test_non_pod(); // test with complex data
+    test_growth_policy();
+    test_append();
+    test_single_context();
+#ifdef CORE_UTIL_HAS_RVALUE_REFERENCES
+    test_move();
+#endif
     MBED_HOSTTEST_ASSERT(Test::inst_count == 0);
 
     MBED_HOSTTEST_RESULT(true);
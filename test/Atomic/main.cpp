@@ -0,0 +1,96 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/Atomic.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+
+using namespace mbed::util;
+
+static const memory_order orders[] = {
+    memory_order_relaxed, memory_order_acquire, memory_order_release, memory_order_acq_rel, memory_order_seq_cst
+};
+static const unsigned num_orders = sizeof(orders) / sizeof(orders[0]);
+
+template<typename T>
+static void test_integer(T initial) {
+    for (unsigned i = 0; i < num_orders; i ++) {
+        memory_order order = orders[i];
+        memory_order load_order = (order == memory_order_release) || (order == memory_order_acq_rel) ? memory_order_acquire : order;
+        memory_order store_order = (order == memory_order_acquire) || (order == memory_order_acq_rel) ? memory_order_release : order;
+        Atomic<T> value(initial);
+
+        MBED_HOSTTEST_ASSERT(value.load(load_order) == initial);
+        value.store((T)(initial + 1), store_order);
+        MBED_HOSTTEST_ASSERT(value.load(load_order) == (T)(initial + 1));
+        MBED_HOSTTEST_ASSERT(value.exchange(initial, order) == (T)(initial + 1));
+        MBED_HOSTTEST_ASSERT(value == initial);
+
+        // Arithmetic and bitwise operations return the previous value
+        MBED_HOSTTEST_ASSERT(value.fetch_add((T)5, order) == initial);
+        MBED_HOSTTEST_ASSERT(value.fetch_sub((T)2, order) == (T)(initial + 5));
+        MBED_HOSTTEST_ASSERT(value.load() == (T)(initial + 3));
+        value = (T)0x0F;
+        MBED_HOSTTEST_ASSERT(value.fetch_or((T)0x30, order) == (T)0x0F);
+        MBED_HOSTTEST_ASSERT(value.fetch_and((T)0x3C, order) == (T)0x3F);
+        MBED_HOSTTEST_ASSERT(value.fetch_xor((T)0x14, order) == (T)0x3C);
+        MBED_HOSTTEST_ASSERT(value.load() == (T)0x28);
+
+        // Compare and exchange update 'expected' when they fail
+        T expected = (T)0x27;
+        MBED_HOSTTEST_ASSERT(!value.compare_exchange_strong(expected, initial, order));
+        MBED_HOSTTEST_ASSERT(expected == (T)0x28);
+        MBED_HOSTTEST_ASSERT(value.compare_exchange_strong(expected, initial, order));
+        MBED_HOSTTEST_ASSERT(value.load() == initial);
+        expected = initial;
+        while (!value.compare_exchange_weak(expected, (T)(initial + 7), order, load_order));
+        MBED_HOSTTEST_ASSERT(value.load() == (T)(initial + 7));
+    }
+}
+
+static void test_pointer() {
+    int data[8];
+    Atomic<int*> p(data);
+
+    MBED_HOSTTEST_ASSERT(p.fetch_add(3) == data);
+    MBED_HOSTTEST_ASSERT(p.load() == data + 3);
+    MBED_HOSTTEST_ASSERT(p.fetch_sub(2, memory_order_relaxed) == data + 3);
+    MBED_HOSTTEST_ASSERT(p == data + 1);
+    int *expected = data;
+    MBED_HOSTTEST_ASSERT(!p.compare_exchange_strong(expected, data + 7));
+    MBED_HOSTTEST_ASSERT(expected == data + 1);
+    MBED_HOSTTEST_ASSERT(p.compare_exchange_strong(expected, data + 7, memory_order_acq_rel));
+    MBED_HOSTTEST_ASSERT(p.exchange(NULL, memory_order_acquire) == data + 7);
+    MBED_HOSTTEST_ASSERT(p.load(memory_order_relaxed) == NULL);
+}
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util Atomic test);
+    MBED_HOSTTEST_START("MBED_UTIL_ATOMIC_TEST");
+
+    test_integer<uint8_t>(250);
+    test_integer<uint16_t>(65530);
+    test_integer<uint32_t>(0xFFFFFFFA);
+    test_integer<uint64_t>(0xFFFFFFFFFFFFFFFAULL);
+    test_integer<int32_t>(-3);
+    test_pointer();
+    atomic_fence(memory_order_seq_cst);
+
+    MBED_HOSTTEST_RESULT(true);
+}
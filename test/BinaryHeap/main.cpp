@@ -22,11 +22,11 @@
 
 using namespace mbed::util;
 
-template<typename T, typename Compare>
+template<typename T, typename Compare, unsigned Arity>
 static void test_heap(const T* data, unsigned data_size, const T* sorted_data,
                       const T* to_remove, unsigned removed_size, const T* sorted_after_remove,
                       const T& not_in_heap) {
-    BinaryHeap<T, Compare> heap;
+    BinaryHeap<T, Compare, Arity> heap;
     const size_t initial_capacity = data_size / 2, grow_capacity = (data_size * 3) / 2, alignment = 4;
     UAllocTraits_t traits = {0};
     MBED_HOSTTEST_ASSERT(heap.init(initial_capacity, grow_capacity, traits, alignment));
@@ -78,7 +78,14 @@ static void test_min_heap_pod() {
     int sorted_after_remove[] = {0, 7, 13, 16, 20, 1000};
 
     printf("********** Starting test_min_heap_pod()\r\n");
-    test_heap<int, MinCompare<int> >(data, sizeof(data)/sizeof(int), sorted_data,
+    test_heap<int, MinCompare<int>, 2>(data, sizeof(data)/sizeof(int), sorted_data,
+                   to_remove, sizeof(to_remove)/sizeof(int), sorted_after_remove,
+                   2000);
+    // Same data with other arities
+    test_heap<int, MinCompare<int>, 3>(data, sizeof(data)/sizeof(int), sorted_data,
+                   to_remove, sizeof(to_remove)/sizeof(int), sorted_after_remove,
+                   2000);
+    test_heap<int, MinCompare<int>, 4>(data, sizeof(data)/sizeof(int), sorted_data,
                    to_remove, sizeof(to_remove)/sizeof(int), sorted_after_remove,
                    2000);
     printf("********** Ending test_min_heap_pod()\r\n");
@@ -91,7 +98,10 @@ static void test_max_heap_pod() {
     unsigned sorted_after_remove[] = {123, 77, 53, 19, 17, 0};
 
     printf("********** Starting test_max_heap_pod()\r\n");
-    test_heap<unsigned, MaxCompare<unsigned> >(data, sizeof(data)/sizeof(unsigned), sorted_data,
+    test_heap<unsigned, MaxCompare<unsigned>, 2>(data, sizeof(data)/sizeof(unsigned), sorted_data,
+                   to_remove, sizeof(to_remove)/sizeof(unsigned), sorted_after_remove,
+                   2000);
+    test_heap<unsigned, MaxCompare<unsigned>, 8>(data, sizeof(data)/sizeof(unsigned), sorted_data,
                    to_remove, sizeof(to_remove)/sizeof(unsigned), sorted_after_remove,
                    2000);
     printf("********** Ending test_max_heap_pod()\r\n");
@@ -135,7 +145,7 @@ static void test_min_heap_non_pod() {
     Test sorted_after_remove[] = {0, 7, 13, 16, 20, 1000};
 
     printf("********** Starting test_min_heap_non_pod()\r\n");
-    test_heap<Test, MinCompare<Test> >(data, sizeof(data)/sizeof(Test), sorted_data,
+    test_heap<Test, MinCompare<Test>, 2>(data, sizeof(data)/sizeof(Test), sorted_data,
                    to_remove, sizeof(to_remove)/sizeof(Test), sorted_after_remove,
                    2000);
     printf("********** Ending test_min_heap_non_pod()\r\n");
@@ -148,12 +158,147 @@ static void test_max_heap_non_pod() {
     Test sorted_after_remove[] = {764, 734, 325, 291, 136, 62, -59, -380, -382, -591, -700, -736, -930};
 
     printf("********** Starting test_max_heap_non_pod()\r\n");
-    test_heap<Test, MaxCompare<Test> >(data, sizeof(data)/sizeof(Test), sorted_data,
+    test_heap<Test, MaxCompare<Test>, 4>(data, sizeof(data)/sizeof(Test), sorted_data,
                    to_remove, sizeof(to_remove)/sizeof(Test), sorted_after_remove,
                    2000);
     printf("********** Ending test_max_heap_non_pod()\r\n");
 }
 
+static void test_remove_moves_up() {
+    // Removing 11 moves 3 (the last element) to a subtree where it must move up
+    int data[] = {0, 10, 1, 11, 12, 2, 3};
+    int sorted_after_remove[] = {0, 1, 2, 3, 10, 12};
+    BinaryHeap<int> heap;
+    UAllocTraits_t traits = {0};
+
+    printf("********** Starting test_remove_moves_up()\r\n");
+    MBED_HOSTTEST_ASSERT(heap.init(8, 8, traits));
+    for (unsigned i = 0; i < sizeof(data) / sizeof(int); i ++) {
+        MBED_HOSTTEST_ASSERT(heap.insert(data[i]));
+    }
+    MBED_HOSTTEST_ASSERT(heap.remove(11));
+    MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    for (unsigned i = 0; i < sizeof(sorted_after_remove) / sizeof(int); i ++) {
+        MBED_HOSTTEST_ASSERT(heap.pop_root() == sorted_after_remove[i]);
+    }
+    printf("********** Ending test_remove_moves_up()\r\n");
+}
+
+template<unsigned Arity, typename Lock>
+static void test_build() {
+    const unsigned data_size = 500;
+    unsigned data[data_size];
+    BinaryHeap<unsigned, MinCompare<unsigned>, Arity, Lock> heap;
+    UAllocTraits_t traits = {0};
+
+    printf("********** Starting test_build()\r\n");
+    MBED_HOSTTEST_ASSERT(heap.init(16, 16, traits));
+    srand(2);
+    for (unsigned i = 0; i < data_size; i ++) {
+        data[i] = rand() % 10000;
+    }
+    // Build a heap from scratch, replacing any previous content
+    MBED_HOSTTEST_ASSERT(heap.insert(20000));
+    MBED_HOSTTEST_ASSERT(heap.build(data, data_size / 2));
+    MBED_HOSTTEST_ASSERT(heap.get_num_elements() == data_size / 2);
+    MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    // Insert a few elements (moved up one by one), then many elements (heap rebuilt)
+    MBED_HOSTTEST_ASSERT(heap.insert_n(data + data_size / 2, 10));
+    MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    MBED_HOSTTEST_ASSERT(heap.insert_n(data + data_size / 2 + 10, 0));
+    MBED_HOSTTEST_ASSERT(heap.insert_n(data + data_size / 2 + 10, data_size / 2 - 10));
+    MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    MBED_HOSTTEST_ASSERT(heap.insert_n(data, data_size));
+    MBED_HOSTTEST_ASSERT(heap.get_num_elements() == 2 * data_size);
+    MBED_HOSTTEST_ASSERT(heap.is_consistent());
+
+    // Every element is found twice, in order
+    unsigned prev = 0;
+    for (unsigned i = 0; i < 2 * data_size; i ++) {
+        unsigned root = heap.pop_root();
+        MBED_HOSTTEST_ASSERT(root >= prev);
+        if (i % 2) {
+            MBED_HOSTTEST_ASSERT(root == prev);
+        }
+        prev = root;
+    }
+    MBED_HOSTTEST_ASSERT(heap.is_empty());
+    printf("********** Ending test_build()\r\n");
+}
+
+#ifdef CORE_UTIL_HAS_RVALUE_REFERENCES
+// An element that owns a buffer and counts how many times it was deep-copied
+struct Movable {
+    Movable(int key): _key(new int(key)) {
+    }
+
+    Movable(const Movable& m): _key(m._key ? new int(*m._key) : NULL) {
+        copies ++;
+    }
+
+    Movable(Movable&& m): _key(m._key) {
+        m._key = NULL;
+    }
+
+    Movable& operator =(const Movable& m) {
+        if (this != &m) {
+            delete _key;
+            _key = m._key ? new int(*m._key) : NULL;
+            copies ++;
+        }
+        return *this;
+    }
+
+    Movable& operator =(Movable&& m) {
+        if (this != &m) {
+            delete _key;
+            _key = m._key;
+            m._key = NULL;
+        }
+        return *this;
+    }
+
+    ~Movable() {
+        delete _key;
+    }
+
+    bool operator <=(const Movable& m) const {
+        return *_key <= *m._key;
+    }
+
+    int *_key;
+    static int copies;
+};
+int Movable::copies = 0;
+
+static void test_move() {
+    int data[] = {291, 62, 364, 63, 753, 325, -382, -736, -930, -927, 734, -591, 136, 753, 576, -59};
+    int sorted_data[] = {-930, -927, -736, -591, -382, -59, 62, 63, 136, 291, 325, 364, 576, 734, 753, 753};
+    const unsigned data_size = sizeof(data) / sizeof(int);
+
+    printf("********** Starting test_move()\r\n");
+    BinaryHeap<Movable> heap;
+    UAllocTraits_t traits = {0};
+    MBED_HOSTTEST_ASSERT(heap.init(4, 4, traits));
+    for (unsigned i = 0; i < data_size; i ++) {
+        if (i % 2) {
+            MBED_HOSTTEST_ASSERT(heap.insert(Movable(data[i])));
+        } else {
+            MBED_HOSTTEST_ASSERT(heap.emplace(data[i]));
+        }
+        MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    }
+    for (unsigned i = 0; i < data_size; i ++) {
+        Movable root = heap.pop_root();
+        MBED_HOSTTEST_ASSERT(*root._key == sorted_data[i]);
+        MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    }
+    MBED_HOSTTEST_ASSERT(heap.is_empty());
+    MBED_HOSTTEST_ASSERT(Movable::copies == 0);
+    printf("********** Ending test_move()\r\n");
+}
+#endif
+
 void app_start(int, char **) {
     MBED_HOSTTEST_TIMEOUT(5);
     MBED_HOSTTEST_SELECT(default);
@@ -166,6 +311,16 @@ void app_start(int, char **) {
     MBED_HOSTTEST_ASSERT(Test::inst_count == 0);
     test_max_heap_non_pod();
     MBED_HOSTTEST_ASSERT(Test::inst_count == 0);
+    test_remove_moves_up();
+    test_build<2, CriticalSectionLock>();
+    test_build<4, CriticalSectionLock>();
+    // The other lock policies (a SpinLock deadlocks if an operation takes it twice)
+    test_build<2, NullLock>();
+    test_build<2, SpinLock>();
+    test_build<4, TicketLock>();
+#ifdef CORE_UTIL_HAS_RVALUE_REFERENCES
+    test_move();
+#endif
     MBED_HOSTTEST_RESULT(true);
 }
 
@@ -0,0 +1,82 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/CriticalSectionLock.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+
+using namespace mbed::util;
+
+#ifdef TARGET_LIKE_POSIX
+static volatile unsigned handler_calls;
+static volatile bool handler_in_critical_section;
+
+static void handler(int signum) {
+    if (CriticalSectionLock::defer_signal(signum))
+        return;
+    handler_in_critical_section = CriticalSectionLock::in_critical_section();
+    handler_calls = handler_calls + 1;
+}
+
+static void test_deferred_signals() {
+    signal(SIGUSR1, handler);
+    signal(SIGUSR2, handler);
+    handler_calls = 0;
+    raise(SIGUSR1);
+    MBED_HOSTTEST_ASSERT(handler_calls == 1);
+    {
+        CriticalSectionLock lock;
+        MBED_HOSTTEST_ASSERT(CriticalSectionLock::in_critical_section());
+        {
+            CriticalSectionLock inner;
+            raise(SIGUSR1);
+            raise(SIGUSR2);
+        }
+        // Still in the outer critical section
+        MBED_HOSTTEST_ASSERT(CriticalSectionLock::in_critical_section());
+        MBED_HOSTTEST_ASSERT(handler_calls == 1);
+        raise(SIGUSR1);
+        MBED_HOSTTEST_ASSERT(handler_calls == 1);
+    }
+    // The deferred signals run when the outer critical section ends, each one once
+    MBED_HOSTTEST_ASSERT(handler_calls == 3);
+    MBED_HOSTTEST_ASSERT(!handler_in_critical_section);
+    MBED_HOSTTEST_ASSERT(!CriticalSectionLock::in_critical_section());
+    signal(SIGUSR1, SIG_DFL);
+    signal(SIGUSR2, SIG_DFL);
+}
+#endif
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util critical section lock test);
+    MBED_HOSTTEST_START("MBED_UTIL_CRITICAL_SECTION_LOCK_TEST");
+
+    {
+        CriticalSectionLock lock;
+        {
+            CriticalSectionLock nested;
+        }
+    }
+#ifdef TARGET_LIKE_POSIX
+    MBED_HOSTTEST_ASSERT(!CriticalSectionLock::in_critical_section());
+    test_deferred_signals();
+#endif
+
+    MBED_HOSTTEST_RESULT(true);
+}
@@ -16,19 +16,180 @@
  */
 
 #include "core-util/ExtendablePoolAllocator.h"
+#include "core-util/atomic_ops.h"
 #include "mbed-drivers/test_env.h"
 #include "ualloc/ualloc.h"
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef TARGET_LIKE_POSIX
+#include <pthread.h>
+#endif
 
 using namespace mbed::util;
 
+// ExtendablePoolAllocator is a class, so code that only uses pointers to it can forward
+// declare it
+namespace mbed {
+namespace util {
+class ExtendablePoolAllocator;
+}
+}
+
 static bool check_value_and_alignment(void *p, unsigned alignment = MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN) {
     if (NULL == p)
         return false;
-    return ((uint32_t)p & (alignment - 1)) == 0;
+    return ((uintptr_t)p & (alignment - 1)) == 0;
+}
+
+template<typename Allocator>
+static void test_many_pools() {
+    // Create a lot of small pools, then free their elements in an interleaved order
+    const size_t pool_elements = 2, total = 40;
+    UAllocTraits_t traits = {0};
+    Allocator allocator;
+    MBED_HOSTTEST_ASSERT(allocator.init(pool_elements, pool_elements, 8, traits));
+    void *blocks[total];
+    for (unsigned i = 0; i < total; i ++) {
+        blocks[i] = allocator.alloc();
+        MBED_HOSTTEST_ASSERT(check_value_and_alignment(blocks[i]));
+    }
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == total / pool_elements);
+    for (unsigned i = 0; i < total; i += 2) {
+        allocator.free(blocks[i]);
+    }
+    for (unsigned i = 1; i < total; i += 2) {
+        allocator.free(blocks[i]);
+    }
+    // Every element must have been returned to its pool
+    for (unsigned i = 0; i < total; i ++) {
+        MBED_HOSTTEST_ASSERT(check_value_and_alignment(allocator.alloc()));
+    }
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == total / pool_elements);
+
+    // All the pools are full now; an element freed in the oldest pool must be found again
+    allocator.free(blocks[0]);
+    MBED_HOSTTEST_ASSERT(allocator.alloc() == blocks[0]);
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == total / pool_elements);
 }
 
+static void test_trim() {
+    const size_t pool_elements = 4, num_pools = 4, total = pool_elements * num_pools;
+    UAllocTraits_t traits = {0};
+    void *blocks[total];
+
+    // Explicit trimming keeps the current pool and one empty pool in reserve
+    {
+        ExtendablePoolAllocator allocator;
+        MBED_HOSTTEST_ASSERT(allocator.init(pool_elements, pool_elements, 8, traits));
+        MBED_HOSTTEST_ASSERT(allocator.alloc_n(blocks, total) == total);
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == num_pools);
+        MBED_HOSTTEST_ASSERT(allocator.trim() == 0); // nothing is empty yet
+        allocator.free_n(blocks, total - pool_elements); // empty all the pools but the current one
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == num_pools);
+        MBED_HOSTTEST_ASSERT(allocator.trim() == num_pools - 2);
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 2);
+        // The remaining elements can still be freed and allocated again
+        allocator.free_n(blocks + total - pool_elements, pool_elements);
+        MBED_HOSTTEST_ASSERT(allocator.alloc_n(blocks, 2 * pool_elements) == 2 * pool_elements);
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 2);
+    }
+
+    // Automatic trimming without reserve
+    {
+        ExtendablePoolAllocator allocator;
+        MBED_HOSTTEST_ASSERT(allocator.init(pool_elements, pool_elements, 8, traits));
+        allocator.set_trim_policy(0, true);
+        for (unsigned i = 0; i < total; i ++) {
+            MBED_HOSTTEST_ASSERT(check_value_and_alignment(blocks[i] = allocator.alloc()));
+        }
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == num_pools);
+        for (unsigned i = 0; i < pool_elements; i ++) {
+            allocator.free(blocks[i]);
+        }
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == num_pools); // one empty pool is tolerated
+        for (unsigned i = pool_elements; i < 2 * pool_elements; i ++) {
+            allocator.free(blocks[i]);
+        }
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == num_pools - 2);
+        for (unsigned i = 2 * pool_elements; i < total; i ++) {
+            allocator.free(blocks[i]);
+        }
+        MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 1); // the current pool is kept
+    }
+}
+
+static void test_growth_policy() {
+    const size_t initial_elements = 4, total = 1024;
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    MBED_HOSTTEST_ASSERT(allocator.init(initial_elements, initial_elements, 8, traits));
+    allocator.set_growth_policy(GrowthPolicy::doubling(initial_elements));
+    for (unsigned i = 0; i < total; i ++) {
+        MBED_HOSTTEST_ASSERT(check_value_and_alignment(allocator.alloc()));
+    }
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 9); // 4, 4, 8, 16, ... 512 elements
+
+    // A denominator of 0 is handled like 1
+    MBED_HOSTTEST_ASSERT(GrowthPolicy(2, 3, 0).get_increment(10) == 30);
+    MBED_HOSTTEST_ASSERT(GrowthPolicy::factor_1_5(2).get_increment(10) == 5);
+}
+
+static void test_oversized_pool() {
+    // Pools larger than PoolAllocator's limit are clamped; a full clamped pool must
+    // be recognized as full, so that the next allocation creates a new pool
+    const size_t max_elements = PoolAllocator::get_max_elements();
+    if (max_elements > 65535) // too much memory for a test on 64-bit hosts
+        return;
+    UAllocTraits_t traits = {0};
+    ExtendablePoolAllocator allocator;
+    MBED_HOSTTEST_ASSERT(allocator.init(max_elements + 10, 4, 4, traits));
+    for (size_t i = 0; i < max_elements; i ++) {
+        MBED_HOSTTEST_ASSERT(check_value_and_alignment(allocator.alloc()));
+    }
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 1);
+    MBED_HOSTTEST_ASSERT(check_value_and_alignment(allocator.alloc()));
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 2);
+}
+
+#if defined(TARGET_LIKE_POSIX) && defined(MBED_UTIL_ATOMIC_USE_BUILTINS)
+// Several threads allocate and free batches of elements while empty pools are released
+// automatically, so pools are created and released concurrently with the other operations
+static const unsigned trim_threads = 4, trim_rounds = 2000, trim_batch = 20;
+
+static void *alloc_free(void *arg) {
+    BasicExtendablePoolAllocator<SpinLock> *allocator = (BasicExtendablePoolAllocator<SpinLock>*)arg;
+    void *blocks[trim_batch];
+    for (unsigned round = 0; round < trim_rounds; round ++) {
+        for (unsigned i = 0; i < trim_batch; i ++) {
+            blocks[i] = allocator->alloc();
+            MBED_HOSTTEST_ASSERT(blocks[i] != NULL);
+            *(uint32_t*)blocks[i] = round;
+        }
+        for (unsigned i = 0; i < trim_batch; i ++) {
+            MBED_HOSTTEST_ASSERT(*(uint32_t*)blocks[i] == round);
+            allocator->free(blocks[i]);
+        }
+    }
+    return NULL;
+}
+
+static void test_auto_trim_threads() {
+    UAllocTraits_t traits = {0};
+    BasicExtendablePoolAllocator<SpinLock> allocator;
+    pthread_t threads[trim_threads];
+    MBED_HOSTTEST_ASSERT(allocator.init(4, 4, sizeof(uint32_t), traits));
+    allocator.set_trim_policy(0, true);
+    for (unsigned i = 0; i < trim_threads; i ++) {
+        MBED_HOSTTEST_ASSERT(pthread_create(&threads[i], NULL, alloc_free, &allocator) == 0);
+    }
+    for (unsigned i = 0; i < trim_threads; i ++) {
+        pthread_join(threads[i], NULL);
+    }
+    // Everything was freed, so only the current pool is left
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 1);
+}
+#endif
+
 void app_start(int, char**) {
     MBED_HOSTTEST_TIMEOUT(5);
     MBED_HOSTTEST_SELECT(default);
@@ -65,6 +226,34 @@ void app_start(int, char**) {
     MBED_HOSTTEST_ASSERT(newp == p);
     MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 2);
 
+    // A bulk allocation larger than a pool must span new pools
+    const size_t bulk = new_pool_elements + new_pool_elements / 2;
+    void *blocks[bulk];
+    MBED_HOSTTEST_ASSERT(allocator.alloc_n(blocks, bulk) == bulk);
+    for (unsigned i = 0; i < bulk; i ++) {
+        MBED_HOSTTEST_ASSERT(check_value_and_alignment(blocks[i]));
+    }
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 4);
+    // Free them all, then check they can be allocated again without adding pools
+    allocator.free_n(blocks, bulk);
+    MBED_HOSTTEST_ASSERT(allocator.alloc_n(blocks, bulk) == bulk);
+    MBED_HOSTTEST_ASSERT(allocator.get_num_pools() == 4);
+
+    test_many_pools<ExtendablePoolAllocator>();
+    // With the other lock policies (a SpinLock deadlocks if an operation takes it twice)
+    test_many_pools<BasicExtendablePoolAllocator<NullLock> >();
+    test_many_pools<BasicExtendablePoolAllocator<SpinLock> >();
+    test_many_pools<BasicExtendablePoolAllocator<TicketLock> >();
+    test_many_pools<BasicExtendablePoolAllocator<MCSLock> >();
+    test_trim();
+    test_growth_policy();
+    test_oversized_pool();
+#if defined(TARGET_LIKE_POSIX) && defined(MBED_UTIL_ATOMIC_USE_BUILTINS)
+    // Without the builtins the atomic operations only mask signals, so they aren't
+    // atomic between threads
+    test_auto_trim_threads();
+#endif
+
     MBED_HOSTTEST_RESULT(true);
 }
 
@@ -0,0 +1,122 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/IndexedBinaryHeap.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mbed::util;
+
+template<typename Compare, unsigned Arity, typename Lock>
+static void test_indexed_heap() {
+    typedef IndexedBinaryHeap<int, Compare, Arity, Lock> heap_t;
+    const unsigned data_size = 200;
+    int values[data_size];
+    bool present[data_size];
+    typename heap_t::handle_t handles[data_size];
+    Compare cmp;
+
+    heap_t heap;
+    UAllocTraits_t traits = {0};
+    MBED_HOSTTEST_ASSERT(heap.init(16, 16, traits));
+    MBED_HOSTTEST_ASSERT(heap.get_root_handle() == heap_t::invalid_handle);
+
+    // Fill the heap with pseudo-random data
+    srand(1);
+    for (unsigned i = 0; i < data_size; i ++) {
+        values[i] = rand() % 1000 - 500;
+        present[i] = true;
+        handles[i] = heap.insert(values[i]);
+        MBED_HOSTTEST_ASSERT(handles[i] != heap_t::invalid_handle);
+        MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    }
+    for (unsigned i = 0; i < data_size; i ++) {
+        MBED_HOSTTEST_ASSERT(heap.contains(handles[i]));
+        MBED_HOSTTEST_ASSERT(heap.get(handles[i]) == values[i]);
+    }
+
+    // Remove every third element by handle
+    for (unsigned i = 0; i < data_size; i += 3) {
+        MBED_HOSTTEST_ASSERT(heap.remove(handles[i]));
+        MBED_HOSTTEST_ASSERT(!heap.contains(handles[i]));
+        MBED_HOSTTEST_ASSERT(!heap.remove(handles[i]));
+        MBED_HOSTTEST_ASSERT(heap.is_consistent());
+        present[i] = false;
+    }
+
+    // Change some values in both directions
+    for (unsigned i = 1; i < data_size; i += 3) {
+        values[i] = rand() % 1000 - 500;
+        MBED_HOSTTEST_ASSERT(heap.update_key(handles[i], values[i]));
+        MBED_HOSTTEST_ASSERT(heap.is_consistent());
+    }
+
+    // Move other elements towards the root. decrease_key refuses to move them away from it.
+    for (unsigned i = 2; i < data_size; i += 3) {
+        int further = cmp(values[i], values[i] + 1) ? values[i] + 1 : values[i] - 1;
+        int closer = cmp(values[i], values[i] + 1) ? values[i] - 100 : values[i] + 100;
+        MBED_HOSTTEST_ASSERT(!heap.decrease_key(handles[i], further));
+        MBED_HOSTTEST_ASSERT(heap.decrease_key(handles[i], closer));
+        MBED_HOSTTEST_ASSERT(heap.is_consistent());
+        values[i] = closer;
+    }
+    MBED_HOSTTEST_ASSERT(heap.get_num_elements() == data_size - (data_size + 2) / 3);
+
+    // Handles of removed elements are reused
+    typename heap_t::handle_t h = heap.insert(0);
+    MBED_HOSTTEST_ASSERT(h == handles[data_size - 2]);
+    MBED_HOSTTEST_ASSERT(heap.remove(h));
+
+    // Pop everything, checking the order and the values
+    int prev = 0;
+    for (unsigned n = 0; !heap.is_empty(); n ++) {
+        typename heap_t::handle_t root_handle = heap.get_root_handle();
+        unsigned i;
+        for (i = 0; i < data_size; i ++) {
+            if (present[i] && (handles[i] == root_handle))
+                break;
+        }
+        MBED_HOSTTEST_ASSERT(i < data_size);
+        int root = heap.pop_root();
+        MBED_HOSTTEST_ASSERT(root == values[i]);
+        MBED_HOSTTEST_ASSERT((n == 0) || cmp(prev, root));
+        MBED_HOSTTEST_ASSERT(heap.is_consistent());
+        present[i] = false;
+        prev = root;
+    }
+    for (unsigned i = 0; i < data_size; i ++) {
+        MBED_HOSTTEST_ASSERT(!present[i]);
+    }
+}
+
+void app_start(int, char **) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util indexed binary heap test);
+    MBED_HOSTTEST_START("MBED_UTIL_INDEXED_BINARY_HEAP_TEST");
+
+    test_indexed_heap<MinCompare<int>, 2, CriticalSectionLock>();
+    test_indexed_heap<MaxCompare<int>, 2, CriticalSectionLock>();
+    test_indexed_heap<MinCompare<int>, 4, CriticalSectionLock>();
+    // With the other lock policies
+    test_indexed_heap<MinCompare<int>, 2, NullLock>();
+    test_indexed_heap<MinCompare<int>, 2, SpinLock>();
+    test_indexed_heap<MinCompare<int>, 2, MCSLock>();
+
+    MBED_HOSTTEST_RESULT(true);
+}
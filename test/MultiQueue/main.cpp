@@ -0,0 +1,80 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/MultiQueue.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mbed::util;
+
+static const unsigned num_elements = 1000;
+
+// Every inserted element must be popped exactly once
+static void test_multi_queue(size_t num_shards) {
+    MultiQueue<unsigned> queue;
+    UAllocTraits_t traits = {0};
+    static unsigned popped[num_elements];
+    unsigned e;
+
+    MBED_HOSTTEST_ASSERT(queue.init(num_shards, 8, 8, traits));
+    MBED_HOSTTEST_ASSERT(!queue.init(num_shards, 8, 8, traits));
+    MBED_HOSTTEST_ASSERT(queue.get_num_shards() == num_shards);
+    MBED_HOSTTEST_ASSERT(queue.is_empty());
+    MBED_HOSTTEST_ASSERT(!queue.pop_root(e));
+    for (unsigned i = 0; i < num_elements; i ++) {
+        popped[i] = 0;
+    }
+    srand(1);
+    for (unsigned i = 0; i < num_elements; i ++) {
+        MBED_HOSTTEST_ASSERT(queue.insert(rand() % num_elements));
+    }
+    MBED_HOSTTEST_ASSERT(queue.get_num_elements() == num_elements);
+    for (unsigned i = 0; i < num_elements; i ++) {
+        MBED_HOSTTEST_ASSERT(queue.pop_root(e));
+        MBED_HOSTTEST_ASSERT(e < num_elements);
+        popped[e] ++;
+    }
+    MBED_HOSTTEST_ASSERT(queue.is_empty());
+    MBED_HOSTTEST_ASSERT(!queue.pop_root(e));
+    srand(1);
+    for (unsigned i = 0; i < num_elements; i ++) {
+        popped[rand() % num_elements] --;
+    }
+    for (unsigned i = 0; i < num_elements; i ++) {
+        MBED_HOSTTEST_ASSERT(popped[i] == 0);
+    }
+}
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util multi queue test);
+    MBED_HOSTTEST_START("MBED_UTIL_MULTI_QUEUE_TEST");
+
+    // The queue needs at least 3 shards
+    MultiQueue<unsigned> small;
+    UAllocTraits_t traits = {0};
+    MBED_HOSTTEST_ASSERT(!small.init(1, 8, 8, traits));
+    MBED_HOSTTEST_ASSERT(!small.init(2, 8, 8, traits));
+
+    test_multi_queue(3);
+    test_multi_queue(4);
+    test_multi_queue(7);
+
+    MBED_HOSTTEST_RESULT(true);
+}
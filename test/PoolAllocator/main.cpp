@@ -19,6 +19,7 @@
 #include "mbed-drivers/test_env.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 using namespace mbed::util;
 
@@ -36,18 +37,24 @@ void app_start(int, char**) {
 
     void *start = malloc(pool_size);
     MBED_HOSTTEST_ASSERT(start != NULL);
+    memset(start, 0xA5, pool_size);
     PoolAllocator allocator(start, elements, element_size);
 
+    // The pool is initialized lazily, so its memory must not be touched by the constructor
+    for (size_t i = 0; i < pool_size; i ++) {
+        MBED_HOSTTEST_ASSERT(((uint8_t*)start)[i] == 0xA5);
+    }
+
     // Allocate all elements, checking for proper alignment and spacing
-    void *p, *prev, *first;
+    void *p, *prev, *first, *blocks[elements + 1];
     for (size_t i = 0; i < elements; i ++) {
-        p = allocator.alloc();
+        p = blocks[i] = allocator.alloc();
         MBED_HOSTTEST_ASSERT(p != NULL);
         // Check alignment
-        MBED_HOSTTEST_ASSERT(((uint32_t)p & (MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN - 1)) == 0);
+        MBED_HOSTTEST_ASSERT(((uintptr_t)p & (MBED_UTIL_POOL_ALLOC_DEFAULT_ALIGN - 1)) == 0);
         // Check spacing
         if (i > 0) {
-            MBED_HOSTTEST_ASSERT(((uint32_t)p - (uint32_t)prev) == aligned_size);
+            MBED_HOSTTEST_ASSERT(((uintptr_t)p - (uintptr_t)prev) == aligned_size);
         } else {
             first = p;
             MBED_HOSTTEST_ASSERT(p == start);
@@ -68,6 +75,38 @@ void app_start(int, char**) {
     p = allocator.alloc();
     MBED_HOSTTEST_ASSERT(p == NULL);
 
+    // Free everything at once, then allocate everything again in a single call
+    allocator.free_n(blocks, elements);
+    MBED_HOSTTEST_ASSERT(allocator.alloc_n(blocks, elements + 1) == elements);
+    for (size_t i = 0; i < elements; i ++) {
+        MBED_HOSTTEST_ASSERT(allocator.owns(blocks[i]));
+        for (size_t j = 0; j < i; j ++) {
+            MBED_HOSTTEST_ASSERT(blocks[i] != blocks[j]);
+        }
+    }
+    MBED_HOSTTEST_ASSERT(allocator.alloc_n(blocks, 1) == 0);
+    free(start);
+
+    // A 32-bit free list head limits the pool to 65535 elements
+    MBED_HOSTTEST_ASSERT(PoolAllocator::get_max_elements() == (MBED_UTIL_POOL_ALLOC_WIDE_HEAD ? 0xFFFFFFFFUL : 65535));
+    const size_t big_elements = MBED_UTIL_POOL_ALLOC_WIDE_HEAD ? 70000 : 65535;
+    start = malloc(PoolAllocator::get_pool_size(big_elements, 4));
+    MBED_HOSTTEST_ASSERT(start != NULL);
+    PoolAllocator big(start, big_elements, 4);
+    size_t allocated = 0;
+    while ((p = big.alloc()) != NULL) {
+        allocated ++;
+    }
+    MBED_HOSTTEST_ASSERT(allocated == big_elements);
+    // The modification tag wraps around without corrupting the list
+    p = (uint8_t*)start + 4 * (allocated - 1);
+    for (size_t i = 0; i < 200000; i ++) {
+        big.free(p);
+        MBED_HOSTTEST_ASSERT(big.alloc() == p);
+    }
+    MBED_HOSTTEST_ASSERT(big.alloc() == NULL);
+    free(start);
+
     MBED_HOSTTEST_RESULT(true);
 }
 
@@ -0,0 +1,79 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/PoolAllocator.h"
+#include "core-util/PoolAllocatorMagazine.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mbed::util;
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util pool allocator magazine test);
+    MBED_HOSTTEST_START("MBED_UTIL_POOL_ALLOCATOR_MAGAZINE_TEST");
+
+    const size_t elements = 10, element_size = 8, capacity = 4;
+    void *start = malloc(PoolAllocator::get_pool_size(elements, element_size));
+    MBED_HOSTTEST_ASSERT(start != NULL);
+    PoolAllocator pool(start, elements, element_size);
+    void *blocks[elements];
+
+    {
+        PoolAllocatorMagazine magazine(pool, capacity);
+
+        // The first allocation refills the magazine with half its capacity
+        blocks[0] = magazine.alloc();
+        MBED_HOSTTEST_ASSERT(blocks[0] == start);
+        MBED_HOSTTEST_ASSERT(magazine.get_num_cached() == capacity / 2 - 1);
+
+        // Allocate everything else through the magazine, then check that the pool is empty
+        for (size_t i = 1; i < elements; i ++) {
+            blocks[i] = magazine.alloc();
+            MBED_HOSTTEST_ASSERT(pool.owns(blocks[i]));
+            for (size_t j = 0; j < i; j ++) {
+                MBED_HOSTTEST_ASSERT(blocks[i] != blocks[j]);
+            }
+        }
+        MBED_HOSTTEST_ASSERT(magazine.alloc() == NULL);
+        MBED_HOSTTEST_ASSERT(pool.alloc() == NULL);
+
+        // Free everything; the magazine never caches more than its capacity
+        for (size_t i = 0; i < elements; i ++) {
+            magazine.free(blocks[i]);
+            MBED_HOSTTEST_ASSERT(magazine.get_num_cached() <= capacity);
+        }
+        MBED_HOSTTEST_ASSERT(magazine.get_num_cached() > 0);
+
+        // Elements that are cached by the magazine can be allocated again
+        void *p = magazine.alloc();
+        MBED_HOSTTEST_ASSERT(pool.owns(p));
+        magazine.free(p);
+    } // the magazine is flushed when it goes out of scope
+
+    // All the elements must be back in the pool now
+    for (size_t i = 0; i < elements; i ++) {
+        MBED_HOSTTEST_ASSERT(pool.alloc() != NULL);
+    }
+    MBED_HOSTTEST_ASSERT(pool.alloc() == NULL);
+
+    free(start);
+    MBED_HOSTTEST_RESULT(true);
+}
+
@@ -0,0 +1,88 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/RadixHeap.h"
+#include "core-util/BinaryHeap.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mbed::util;
+
+// The value of each element is a copy of its key, stored in a reference BinaryHeap too
+template<typename Key, typename Lock>
+static void test_radix_heap(Key start, Key max_delta) {
+    RadixHeap<Key, Key, Lock> heap;
+    BinaryHeap<Key> reference;
+    UAllocTraits_t traits = {0};
+    Key key, now = start;
+
+    MBED_HOSTTEST_ASSERT(heap.init(4, 4, traits));
+    MBED_HOSTTEST_ASSERT(reference.init(16, 16, traits));
+    MBED_HOSTTEST_ASSERT(heap.is_empty());
+    srand(1);
+    // Insert and remove elements, with keys in the future of the last removed key
+    for (unsigned i = 0; i < 2000; i ++) {
+        if ((rand() % 3 != 0) || heap.is_empty()) {
+            Key delta = (Key)(((uint64_t)rand() * rand()) % max_delta);
+            if (delta > (Key)(~(Key)0 - now))
+                delta = ~(Key)0 - now; // don't wrap around
+            Key k = now + delta;
+            MBED_HOSTTEST_ASSERT(heap.insert(k, k));
+            MBED_HOSTTEST_ASSERT(reference.insert(k));
+        } else {
+            Key value = heap.pop_root(&key);
+            MBED_HOSTTEST_ASSERT(value == key);
+            MBED_HOSTTEST_ASSERT(key == reference.pop_root());
+            MBED_HOSTTEST_ASSERT(heap.get_last_key() == key);
+            now = key;
+        }
+        MBED_HOSTTEST_ASSERT(heap.get_num_elements() == reference.get_num_elements());
+    }
+    // Keys smaller than the last removed key are rejected
+    if (now > 0) {
+        MBED_HOSTTEST_ASSERT(!heap.insert(now - 1, now - 1));
+    }
+    MBED_HOSTTEST_ASSERT(heap.insert(now, now));
+    MBED_HOSTTEST_ASSERT(reference.insert(now));
+    // Empty the heap
+    while (!heap.is_empty()) {
+        Key value = heap.get_root(&key);
+        MBED_HOSTTEST_ASSERT(value == key);
+        MBED_HOSTTEST_ASSERT(key == reference.pop_root());
+        heap.remove_root();
+    }
+    MBED_HOSTTEST_ASSERT(reference.is_empty());
+}
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util radix heap test);
+    MBED_HOSTTEST_START("MBED_UTIL_RADIX_HEAP_TEST");
+
+    test_radix_heap<uint32_t, CriticalSectionLock>(0, 100);
+    test_radix_heap<uint32_t, CriticalSectionLock>(1000, 1000000);
+    test_radix_heap<uint32_t, CriticalSectionLock>(0x80000000, 0x7FFFFFFF);
+    test_radix_heap<uint8_t, CriticalSectionLock>(0, 255);
+    test_radix_heap<uint64_t, CriticalSectionLock>(0x100000000ULL, 0x10000000000ULL);
+    // With the other lock policies
+    test_radix_heap<uint32_t, NullLock>(1000, 1000000);
+    test_radix_heap<uint32_t, TicketLock>(1000, 1000000);
+
+    MBED_HOSTTEST_RESULT(true);
+}
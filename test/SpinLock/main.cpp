@@ -0,0 +1,114 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/SpinLock.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+#ifdef TARGET_LIKE_POSIX
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+using namespace mbed::util;
+
+template<typename Lock>
+static void test_try_lock() {
+    Lock lock;
+    MBED_HOSTTEST_ASSERT(lock.try_lock());
+    MBED_HOSTTEST_ASSERT(!lock.try_lock());
+    lock.unlock();
+    {
+        ScopedLock<Lock> guard(lock);
+        MBED_HOSTTEST_ASSERT(!lock.try_lock());
+    }
+    MBED_HOSTTEST_ASSERT(lock.try_lock());
+    lock.unlock();
+}
+
+static void test_mcs_lock() {
+    MCSLock lock;
+    MCSLock::node n1, n2;
+    MBED_HOSTTEST_ASSERT(lock.try_lock(n1));
+    MBED_HOSTTEST_ASSERT(!lock.try_lock(n2));
+    lock.unlock(n1);
+    {
+        ScopedLock<MCSLock> guard(lock);
+        MBED_HOSTTEST_ASSERT(!lock.try_lock(n1));
+    }
+    lock.lock(n2);
+    lock.unlock(n2);
+    MBED_HOSTTEST_ASSERT(lock.try_lock(n1));
+    lock.unlock(n1);
+}
+
+#ifdef TARGET_LIKE_POSIX
+// Several threads increment a counter with a non-atomic read-modify-write under the lock
+static const unsigned num_threads = 4, increments = 20000;
+
+template<typename Lock>
+struct shared_counter {
+    Lock lock;
+    volatile unsigned value;
+};
+
+template<typename Lock>
+static void *increment(void *arg) {
+    shared_counter<Lock> *counter = (shared_counter<Lock>*)arg;
+    for (unsigned i = 0; i < increments; i ++) {
+        ScopedLock<Lock> guard(counter->lock);
+        counter->value = counter->value + 1;
+    }
+    return NULL;
+}
+
+// The FIFO locks must not be used by more threads than cores
+template<typename Lock>
+static void test_threads(bool fifo) {
+    shared_counter<Lock> counter;
+    pthread_t threads[num_threads];
+    unsigned n = num_threads;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (fifo && (cores > 0) && ((unsigned long)cores < n))
+        n = (unsigned)cores;
+    counter.value = 0;
+    for (unsigned i = 0; i < n; i ++) {
+        MBED_HOSTTEST_ASSERT(pthread_create(&threads[i], NULL, increment<Lock>, &counter) == 0);
+    }
+    for (unsigned i = 0; i < n; i ++) {
+        pthread_join(threads[i], NULL);
+    }
+    MBED_HOSTTEST_ASSERT(counter.value == n * increments);
+}
+#endif
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(10);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util spin lock test);
+    MBED_HOSTTEST_START("MBED_UTIL_SPIN_LOCK_TEST");
+
+    test_try_lock<SpinLock>();
+    test_try_lock<TicketLock>();
+    test_mcs_lock();
+#ifdef TARGET_LIKE_POSIX
+    test_threads<SpinLock>(false);
+    test_threads<TicketLock>(true);
+    test_threads<MCSLock>(true);
+#endif
+
+    MBED_HOSTTEST_RESULT(true);
+}
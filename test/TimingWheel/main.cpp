@@ -0,0 +1,165 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/TimingWheel.h"
+#include "core-util/FunctionPointer.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mbed::util;
+
+static int fired[8], num_fired;
+
+static void on_timer(int id) {
+    fired[num_fired ++] = id;
+}
+
+static void test_events() {
+    TimingWheel<> wheel;
+    UAllocTraits_t traits = {0};
+    FunctionPointer1<void, int> fp(on_timer);
+    Event e;
+
+    MBED_HOSTTEST_ASSERT(wheel.init(4, traits, 1000));
+    TimingWheel<>::handle_t h1 = wheel.schedule(10, fp.bind(1));
+    TimingWheel<>::handle_t h2 = wheel.schedule(5000, fp.bind(2));
+    TimingWheel<>::handle_t h3 = wheel.schedule(0, fp.bind(3));
+    TimingWheel<>::handle_t h4 = wheel.schedule(70, fp.bind(4));
+    MBED_HOSTTEST_ASSERT((h1 != NULL) && (h2 != NULL) && (h3 != NULL) && (h4 != NULL));
+    // The wheel is full
+    MBED_HOSTTEST_ASSERT(wheel.schedule(1, fp.bind(5)) == NULL);
+    MBED_HOSTTEST_ASSERT(wheel.get_num_timers() == 4);
+
+    // A delay of 0 expires at the next tick
+    wheel.advance(1001);
+    MBED_HOSTTEST_ASSERT(wheel.pop_expired(e));
+    e.call();
+    MBED_HOSTTEST_ASSERT(!wheel.pop_expired(e));
+    wheel.advance(1009);
+    MBED_HOSTTEST_ASSERT(!wheel.pop_expired(e));
+    wheel.advance(1010);
+    MBED_HOSTTEST_ASSERT(wheel.pop_expired(e));
+    e.call();
+    // Cancel a pending timer
+    wheel.cancel(h4);
+    MBED_HOSTTEST_ASSERT(wheel.get_num_timers() == 1);
+    // Timers in the higher levels are cascaded down to level 0 before they expire
+    wheel.advance(5999);
+    MBED_HOSTTEST_ASSERT(!wheel.pop_expired(e));
+    wheel.advance(7000);
+    MBED_HOSTTEST_ASSERT(wheel.pop_expired(e));
+    e.call();
+    MBED_HOSTTEST_ASSERT(wheel.get_num_timers() == 0);
+    MBED_HOSTTEST_ASSERT(wheel.get_time() == 7000);
+
+    // Expired timers can be cancelled before they are popped
+    TimingWheel<>::handle_t h = wheel.schedule(1, fp.bind(6));
+    wheel.advance(7001);
+    wheel.cancel(h);
+    MBED_HOSTTEST_ASSERT(!wheel.pop_expired(e));
+
+    MBED_HOSTTEST_ASSERT(num_fired == 3);
+    MBED_HOSTTEST_ASSERT((fired[0] == 3) && (fired[1] == 1) && (fired[2] == 2));
+}
+
+static void test_random(uint32_t start) {
+    const unsigned num_timers = 1000;
+    uint32_t expires[num_timers];
+    bool pending[num_timers];
+    TimingWheel<unsigned>::handle_t handles[num_timers];
+    TimingWheel<unsigned> wheel;
+    UAllocTraits_t traits = {0};
+    unsigned id;
+
+    MBED_HOSTTEST_ASSERT(wheel.init(num_timers, traits, start));
+    srand(start);
+    // Delays from a few ticks to the whole 32-bit range
+    for (unsigned i = 0; i < num_timers; i ++) {
+        uint32_t delay = (((uint32_t)rand() << 16) ^ (uint32_t)rand()) >> (rand() % 32);
+        if (delay == 0)
+            delay = 1;
+        expires[i] = start + delay;
+        pending[i] = true;
+        handles[i] = wheel.schedule(delay, i);
+        MBED_HOSTTEST_ASSERT(handles[i] != NULL);
+    }
+    for (unsigned i = 0; i < num_timers; i += 7) {
+        wheel.cancel(handles[i]);
+        pending[i] = false;
+    }
+
+    // Advance the time in increasingly large steps until all the timers expire, checking
+    // that each timer expires in the right step
+    uint32_t now = start, elapsed = 0, step = 1;
+    while (wheel.get_num_timers() > 0) {
+        if (step > 0xFFFFFFFF - elapsed)
+            step = 0xFFFFFFFF - elapsed;
+        MBED_HOSTTEST_ASSERT(step > 0);
+        now += step;
+        elapsed += step;
+        wheel.advance(now);
+        while (wheel.pop_expired(id)) {
+            MBED_HOSTTEST_ASSERT(pending[id]);
+            MBED_HOSTTEST_ASSERT(expires[id] - start <= elapsed);
+            MBED_HOSTTEST_ASSERT(expires[id] - start > elapsed - step);
+            pending[id] = false;
+        }
+        if (step < 0x1000000)
+            step = step * 3 / 2 + 1;
+    }
+    for (unsigned i = 0; i < num_timers; i ++) {
+        MBED_HOSTTEST_ASSERT(!pending[i]);
+    }
+}
+
+// Advance the time directly to the tick before the expiration of a single timer, then to
+// its expiration tick, and check that the timer expires exactly at that tick
+static void test_exact(uint32_t start) {
+    static const uint32_t delays[] = {1, 2, 5, 6, 7, 54, 55, 63, 64, 65, 127, 4095, 4096, 100000};
+    UAllocTraits_t traits = {0};
+    unsigned id;
+
+    for (unsigned i = 0; i < sizeof(delays) / sizeof(delays[0]); i ++) {
+        TimingWheel<unsigned, SpinLock> wheel; // with a different lock policy
+        MBED_HOSTTEST_ASSERT(wheel.init(1, traits, start));
+        MBED_HOSTTEST_ASSERT(wheel.schedule(delays[i], i) != NULL);
+        wheel.advance(start + delays[i] - 1);
+        MBED_HOSTTEST_ASSERT(!wheel.pop_expired(id));
+        wheel.advance(start + delays[i]);
+        MBED_HOSTTEST_ASSERT(wheel.pop_expired(id));
+        MBED_HOSTTEST_ASSERT(id == i);
+    }
+}
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util timing wheel test);
+    MBED_HOSTTEST_START("MBED_UTIL_TIMING_WHEEL_TEST");
+
+    test_events();
+    test_random(0);
+    test_random(0xFFFFF000); // the time wraps around
+    test_random(0x8000003F);
+    for (uint32_t start = 0; start < 64; start ++) {
+        test_exact(start);
+    }
+    test_exact(0xFFFFFFC0); // the time wraps around
+
+    MBED_HOSTTEST_RESULT(true);
+}
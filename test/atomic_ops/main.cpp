@@ -0,0 +1,115 @@
+/*
+ * PackageLicenseDeclared: Apache-2.0
+ * Copyright (c) 2015 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core-util/atomic_ops.h"
+#include "mbed-drivers/test_env.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace mbed::util;
+
+template<typename T>
+static void test_cas_incr_decr(T initial) {
+    T value = initial, expected = initial + 1;
+
+    // A CAS with the wrong expected value must fail and return the current value
+    MBED_HOSTTEST_ASSERT(!atomic_cas(&value, &expected, (T)(initial + 2)));
+    MBED_HOSTTEST_ASSERT(expected == initial);
+    MBED_HOSTTEST_ASSERT(value == initial);
+
+    // A CAS with the right expected value must succeed
+    MBED_HOSTTEST_ASSERT(atomic_cas(&value, &expected, (T)(initial + 2)));
+    MBED_HOSTTEST_ASSERT(value == (T)(initial + 2));
+
+    // Increment and decrement return the new value
+    MBED_HOSTTEST_ASSERT(atomic_incr(&value, (T)3) == (T)(initial + 5));
+    MBED_HOSTTEST_ASSERT(atomic_decr(&value, (T)5) == initial);
+    MBED_HOSTTEST_ASSERT(value == initial);
+}
+
+static void test_pointer_cas() {
+    int a, b;
+    int *p = &a, *expected = &b;
+
+    MBED_HOSTTEST_ASSERT(!atomic_cas(&p, &expected, &b));
+    MBED_HOSTTEST_ASSERT(expected == &a);
+    MBED_HOSTTEST_ASSERT(atomic_cas(&p, &expected, &b));
+    MBED_HOSTTEST_ASSERT(p == &b);
+}
+
+static void test_cas2() {
+    atomic_dword value, expected, desired;
+    value.lo = 1;
+    value.hi = 2;
+    expected.lo = 1;
+    expected.hi = 3;
+    desired.lo = 4;
+    desired.hi = 5;
+
+    // Both words must match, and the current value is returned on failure
+    MBED_HOSTTEST_ASSERT(!atomic_cas2(&value, &expected, desired));
+    MBED_HOSTTEST_ASSERT((expected.lo == 1) && (expected.hi == 2));
+    MBED_HOSTTEST_ASSERT((value.lo == 1) && (value.hi == 2));
+    MBED_HOSTTEST_ASSERT(atomic_cas2(&value, &expected, desired));
+    MBED_HOSTTEST_ASSERT((value.lo == 4) && (value.hi == 5));
+    MBED_HOSTTEST_ASSERT((expected.lo == 1) && (expected.hi == 2));
+
+    // A CAS loop that updates a pointer and a tag together
+    atomic_dword head = value;
+    for (unsigned i = 0; i < 100; i ++) {
+        atomic_dword old = head, next;
+        do {
+            next.lo = old.lo + 1;
+            next.hi = old.hi + 1;
+        } while (!atomic_cas2(&head, &old, next));
+    }
+    MBED_HOSTTEST_ASSERT((head.lo == 104) && (head.hi == 105));
+    MBED_HOSTTEST_ASSERT(((uintptr_t)&head % sizeof(atomic_dword)) == 0);
+}
+
+static void test_is_lock_free() {
+    // The generic implementation is never lock-free
+    MBED_HOSTTEST_ASSERT(!atomic_is_lock_free<int>::value);
+#ifdef MBED_UTIL_ATOMIC_USE_BUILTINS
+    MBED_HOSTTEST_ASSERT(atomic_is_lock_free<uint32_t>::value);
+    MBED_HOSTTEST_ASSERT(atomic_is_lock_free<int*>::value);
+#endif
+#ifdef MBED_UTIL_ATOMIC_CAS2_LOCK_FREE
+    MBED_HOSTTEST_ASSERT(atomic_is_lock_free<atomic_dword>::value);
+#else
+    MBED_HOSTTEST_ASSERT(!atomic_is_lock_free<atomic_dword>::value);
+#endif
+}
+
+void app_start(int, char**) {
+    MBED_HOSTTEST_TIMEOUT(5);
+    MBED_HOSTTEST_SELECT(default);
+    MBED_HOSTTEST_DESCRIPTION(mbed-util atomic operations test);
+    MBED_HOSTTEST_START("MBED_UTIL_ATOMIC_OPS_TEST");
+
+    test_cas_incr_decr<uint8_t>(250);
+    test_cas_incr_decr<uint16_t>(65530);
+    test_cas_incr_decr<uint32_t>(0xFFFFFFF0UL);
+    test_cas_incr_decr<uint64_t>(0xFFFFFFFFFFFFFFF0ULL);
+    test_cas_incr_decr<int>(-2); // not specialized, uses the generic implementation
+    test_pointer_cas();
+    test_cas2();
+    test_is_lock_free();
+
+    MBED_HOSTTEST_RESULT(true);
+}
+